@@ -0,0 +1,161 @@
+#include "bakeLayout.h"
+#include "resolver.h"
+
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+// Version of the sidecar format, layouts of other versions are ignored
+const int bakeLayoutVersion = 3;
+
+//=================================================================================================
+// Writes a layout sidecar
+// One record per line, filenames come last so they may contain spaces.
+//=================================================================================================
+void writeBakeLayout(const std::string& filename, const BakeLayout& layout)
+{
+	std::ofstream outfile(filename.c_str());
+	if (!outfile)
+	{
+		throw std::runtime_error("Unable to open layout file: " + filename);
+	}
+
+	outfile << "bakeLayout " << bakeLayoutVersion << std::endl;
+	outfile << "settings " << layout.settings << std::endl;
+	for(size_t i=0; i<layout.sources.size(); ++i)
+	{
+		const SourceFile& source = layout.sources[i];
+		outfile << "source " << std::hex << source.hash << std::dec << " " << source.filename << std::endl;
+	}
+	outfile << "atlas " << layout.atlas.sizeX << " " << layout.atlas.sizeY << std::endl;
+	for(size_t i=0; i<layout.atlas.tiles.size(); ++i)
+	{
+		const AtlasTile& tile = layout.atlas.tiles[i];
+		outfile << "tile " << std::hex << tile.hash << std::dec
+			<< " " << tile.exactWidth << " " << tile.exactHeight
+			<< " " << tile.cropX << " " << tile.cropY << " " << tile.cropWidth << " " << tile.cropHeight
+			<< " " << tile.scaledWidth << " " << tile.scaledHeight
+			<< " " << tile.offsetX << " " << tile.offsetY << " " << tile.alphaMode
+			<< " " << tile.filename << std::endl;
+		if (!tile.opacityFilename.empty())
+		{
+			outfile << "opacity " << std::hex << tile.opacityHash << std::dec << " " << tile.opacityFilename << std::endl;
+		}
+	}
+}
+
+//=================================================================================================
+// Reads the filename at the end of a record, after the single separating space
+//=================================================================================================
+bool readFilename(std::istream& stream, std::string& filename)
+{
+	if (stream.get() != ' ')
+	{
+		return false;
+	}
+	std::getline(stream, filename);
+	return !filename.empty();
+}
+
+//=================================================================================================
+// Reads a layout sidecar
+//=================================================================================================
+bool readBakeLayout(const std::string& filename, BakeLayout& layout)
+{
+	std::ifstream infile(filename.c_str());
+	if (!infile)
+	{
+		return false;
+	}
+
+	std::string line;
+	std::string type;
+	int version = 0;
+	std::getline(infile, line);
+	std::istringstream header(line);
+	if (!(header >> type >> version) || type != "bakeLayout" || version != bakeLayoutVersion)
+	{
+		return false;
+	}
+
+	layout = BakeLayout();
+	layout.atlas.sizeX = 0;
+	layout.atlas.sizeY = 0;
+	while(std::getline(infile, line))
+	{
+		std::istringstream stream(line);
+		type.clear();
+		stream >> type;
+		if (type == "settings")
+		{
+			if (stream.get() != ' ')
+			{
+				return false;
+			}
+			std::getline(stream, layout.settings);
+		}
+		else if (type == "source")
+		{
+			SourceFile source;
+			if (!(stream >> std::hex >> source.hash >> std::dec) || !readFilename(stream, source.filename))
+			{
+				return false;
+			}
+			layout.sources.push_back(source);
+		}
+		else if (type == "atlas")
+		{
+			if (!(stream >> layout.atlas.sizeX >> layout.atlas.sizeY))
+			{
+				return false;
+			}
+		}
+		else if (type == "tile")
+		{
+			AtlasTile tile;
+			tile.opacityHash = 0;
+			stream >> std::hex >> tile.hash >> std::dec
+				>> tile.exactWidth >> tile.exactHeight
+				>> tile.cropX >> tile.cropY >> tile.cropWidth >> tile.cropHeight
+				>> tile.scaledWidth >> tile.scaledHeight
+				>> tile.offsetX >> tile.offsetY >> tile.alphaMode;
+			if (!stream || !readFilename(stream, tile.filename))
+			{
+				return false;
+			}
+			layout.atlas.tiles.push_back(tile);
+		}
+		else if (type == "opacity")
+		{
+			// Opacity map baked into the alpha of the preceding tile
+			if (layout.atlas.tiles.empty())
+			{
+				return false;
+			}
+			AtlasTile& tile = layout.atlas.tiles.back();
+			if (!(stream >> std::hex >> tile.opacityHash >> std::dec) || !readFilename(stream, tile.opacityFilename))
+			{
+				return false;
+			}
+		}
+		else
+		{
+			return false;
+		}
+	}
+	return layout.atlas.sizeX > 0 && layout.atlas.sizeY > 0 && !layout.sources.empty();
+}
+
+//=================================================================================================
+// Hashes a file as it is stored on disk
+//=================================================================================================
+bool hashFile(const std::string& filename, unsigned long long& hash)
+{
+	std::ifstream infile(filename.c_str(), std::ios::in | std::ios::binary);
+	if (!infile)
+	{
+		return false;
+	}
+	hash = hashStream(infile);
+	return true;
+}
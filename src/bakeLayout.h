@@ -0,0 +1,34 @@
+#ifndef BAKE_LAYOUT_H
+#define BAKE_LAYOUT_H
+
+#include "packer.h"
+
+#include <string>
+#include <vector>
+
+//! Input file of a bake and the hash of its contents
+struct SourceFile
+{
+	std::string        filename;
+	unsigned long long hash;
+};
+
+//! Sidecar written next to the baked files, lets a later bake update the atlas in place
+//! when only the contents of textures changed
+struct BakeLayout
+{
+	std::string             settings; //!< Input, outputs and options the files were baked with
+	std::vector<SourceFile> sources;  //!< The obj file and its material libraries
+	AtlasPlacement          atlas;    //!< Placement of the textures, with the hashes of the texture files
+};
+
+//! Writes a layout sidecar
+void writeBakeLayout(const std::string& filename, const BakeLayout& layout);
+
+//! Reads a layout sidecar, returns false if the file is missing or not a valid layout
+bool readBakeLayout(const std::string& filename, BakeLayout& layout);
+
+//! Hashes a file as it is stored on disk, returns false if it can not be opened
+bool hashFile(const std::string& filename, unsigned long long& hash);
+
+#endif
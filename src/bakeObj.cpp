@@ -1,48 +1,298 @@
 #include "bakeObj.h"
 #include "parser.h"
-#include "packer.h"
+#include "pipeline.h"
+#include "streamer.h"
+#include "daemon.h"
 #include <iostream>
 #include <fstream>
+#include <cstdlib>
+#include <algorithm>
 
 int main(int argc, char** argv)
 {
-	if (argc < 2)
+	BakeOptions options;
+	std::string daemonSocket;
+	std::vector<std::string> arguments;
+	for (int i=1; i<argc; i++)
 	{
-		std::cout << "usage: bakeObj input-file [output-name]" << std::endl;
+		std::string argument(argv[i]);
+		if (argument == "--streaming")
+		{
+			options.streaming = true;
+		}
+		else if (argument == "--atlas-size" && i+1 < argc)
+		{
+			options.maxAtlasSize = atoi(argv[++i]);
+		}
+		else if (argument == "--lods" && i+1 < argc)
+		{
+			options.lodCount = atoi(argv[++i]);
+		}
+		else if (argument == "--binary")
+		{
+			options.binary = true;
+		}
+		else if (argument == "--quantize")
+		{
+			options.binary = true;
+			options.quantize = true;
+		}
+		else if (argument == "--normal-bits" && i+1 < argc)
+		{
+			options.normalBits = atoi(argv[++i]) <= 8 ? 8 : 16;
+		}
+		else if (argument == "--tangents")
+		{
+			options.binary = true;
+			options.tangents = true;
+		}
+		else if (argument == "--chunks")
+		{
+			options.chunks = true;
+		}
+		else if (argument == "--crease-angle" && i+1 < argc)
+		{
+			options.creaseAngle = (float) atof(argv[++i]);
+		}
+		else if (argument == "--shared-atlas" && i+1 < argc)
+		{
+			options.sharedAtlas = argv[++i];
+		}
+		else if (argument == "--weld")
+		{
+			options.weld = true;
+		}
+		else if (argument == "--incremental")
+		{
+			options.incremental = true;
+		}
+		else if (argument == "--png-level" && i+1 < argc)
+		{
+			options.png.level = std::max(0, std::min(9, atoi(argv[++i])));
+		}
+		else if (argument == "--png-filter" && i+1 < argc)
+		{
+			if (!parsePngFilter(argv[++i], options.png.filter))
+			{
+				std::cerr << "unknown png filter " << argv[i] << ", using adaptive filters" << std::endl;
+				options.png.filter = pngFilterAdaptive;
+			}
+		}
+		else if (argument == "--texture-arrays")
+		{
+			options.textureArrays = true;
+		}
+		else if (argument == "--alpha-texels")
+		{
+			options.alphaTexels = true;
+		}
+		else if (argument == "--pages" && i+1 < argc)
+		{
+			options.pageSize = atoi(argv[++i]);
+		}
+		else if (argument == "--daemon" && i+1 < argc)
+		{
+			daemonSocket = argv[++i];
+		}
+		else if (argument == "--meshlets")
+		{
+			options.binary = true;
+			options.meshlets = true;
+		}
+		else
+		{
+			arguments.push_back(argument);
+		}
+	}
+
+	if (!daemonSocket.empty())
+	{
+		// Requests are baked in memory into an obj file, a material file and one atlas image
+		if (options.streaming)
+		{
+			std::cerr << "requests are not streamed by the daemon" << std::endl;
+		}
+		if (options.lodCount > 0)
+		{
+			std::cerr << "levels of detail are not generated by the daemon" << std::endl;
+		}
+		if (options.binary)
+		{
+			std::cerr << "binary files, quantized attributes, tangents and meshlets are not written by the daemon" << std::endl;
+		}
+		if (!options.sharedAtlas.empty() || !arguments.empty())
+		{
+			std::cerr << "input files are not baked by the daemon, requests name their own" << std::endl;
+		}
+		if (options.incremental)
+		{
+			std::cerr << "incremental bakes are not supported by the daemon" << std::endl;
+		}
+		if (options.pageSize > 0)
+		{
+			std::cerr << "virtual texture pages are not written by the daemon" << std::endl;
+		}
+		if (options.textureArrays)
+		{
+			std::cerr << "texture arrays are not written by the daemon" << std::endl;
+		}
+		try
+		{
+			std::cout << "serving bake requests on " << daemonSocket << std::endl;
+			runBakeDaemon(options, daemonSocket);
+			return 0;
+		}
+		catch(std::runtime_error& e)
+		{
+			std::cerr << e.what() << std::endl;
+			return -1;
+		}
+	}
+
+	if (arguments.size() < 1)
+	{
+		std::cout << "usage: bakeObj [options] input-file [output-name]" << std::endl;
+		std::cout << "       bakeObj [options] --shared-atlas atlas-name input-file..." << std::endl;
+		std::cout << "       bakeObj [options] --daemon socket-path" << std::endl;
 		std::cout << "parameters:" << std::endl;
-		std::cout << "  input-file: filename of the input obj file (with extension)" << std::endl;
+		std::cout << "  input-file: filename of the input obj file (with extension), may be gzip or zstd compressed" << std::endl;
 		std::cout << "  output-name: base filename of the output files (without extension)" << std::endl;
+		std::cout << "options:" << std::endl;
+		std::cout << "  --streaming: bake out-of-core, without loading the whole mesh into memory" << std::endl;
+		std::cout << "  --atlas-size N: scale the textures down to a common texel density so that the atlas fits into N pixels" << std::endl;
+		std::cout << "  --lods N: also write N simplified levels of detail (output-name.lod1.obj, ...) using the same atlas" << std::endl;
+		std::cout << "  --binary: write the meshes as binary files (output-name.bin) instead of obj files" << std::endl;
+		std::cout << "  --quantize: write binary files with 16-bit positions and texture coordinates and octahedral normals" << std::endl;
+		std::cout << "  --normal-bits N: bits per quantized normal component, 8 or 16 (default)" << std::endl;
+		std::cout << "  --tangents: write binary files with a tangent and bitangent sign per vertex for normal mapping" << std::endl;
+		std::cout << "  --chunks: split the baked mesh into spatial chunks (groups) of less than 65536 vertices" << std::endl;
+		std::cout << "  --crease-angle A: sharpest angle in degrees that is smoothed when generating missing normals (default 60)" << std::endl;
+		std::cout << "  --meshlets: write binary files with the faces split into meshlets of 64 vertices and 124 triangles" << std::endl;
+		std::cout << "  --shared-atlas atlas-name: bake all input files into one atlas (atlas-name.png) and material (atlas-name.mtl)," << std::endl;
+		std::cout << "      each mesh is written to input-file.baked.obj" << std::endl;
+		std::cout << "  --weld: merge vertices whose positions, normals and texture coordinates match but were written as separate records" << std::endl;
+		std::cout << "  --incremental: write a layout sidecar (output-name.layout), later runs only re-blit the textures whose" << std::endl;
+		std::cout << "      contents changed if the mesh, materials and texture sizes did not" << std::endl;
+		std::cout << "  --png-level N: zlib compression level of the atlas from 0 (fastest) to 9 (smallest), default 6" << std::endl;
+		std::cout << "  --png-filter F: row filter of the atlas, none, sub, up, average, paeth or adaptive (default)" << std::endl;
+		std::cout << "  --texture-arrays: write the textures as layers of texture arrays (output-name.arrayWxH.png) bucketed by" << std::endl;
+		std::cout << "      power of two size instead of an atlas, texture coordinates are kept and a texture array index" << std::endl;
+		std::cout << "      (output-name.arrays) lists the layer of each baked material, --atlas-size limits the layer size" << std::endl;
+		std::cout << "  --alpha-texels: classify textured materials as opaque, alpha tested or blended by the alpha channel" << std::endl;
+		std::cout << "      of their texels instead of by their d value, materials with an opacity map (map_d) are always" << std::endl;
+		std::cout << "      classified by their texels, whose alpha is taken from the opacity map" << std::endl;
+		std::cout << "  --pages N: write the atlas as virtual texture pages of N pixels plus a border (output-name.pageL_X_Y.png)," << std::endl;
+		std::cout << "      a mip tail (output-name.tail.png) and a page table (output-name.pages) that the material refers to" << std::endl;
+		std::cout << "  --daemon socket-path: serve bake requests with in-memory files on a local socket," << std::endl;
+		std::cout << "      the decoded textures of the last request are kept for the next one, requests are baked into an obj" << std::endl;
+		std::cout << "      file and one atlas, only --atlas-size, --png-level, --png-filter, --crease-angle, --weld, --chunks" << std::endl;
+		std::cout << "      and --alpha-texels apply" << std::endl;
 		return 0;
 	}
 
-	std::string filename_in(argv[1]);
+	if (options.textureArrays && options.pageSize > 0)
+	{
+		std::cerr << "virtual texture pages are not written with texture arrays" << std::endl;
+		options.pageSize = 0;
+	}
+
+	if (!options.sharedAtlas.empty())
+	{
+		if (options.streaming)
+		{
+			std::cerr << "a shared atlas can not be baked when streaming" << std::endl;
+			return -1;
+		}
+		if (options.incremental)
+		{
+			std::cerr << "incremental bakes are not supported with a shared atlas" << std::endl;
+		}
+		std::string textureExtension = options.pageSize > 0 ? ".pages" : (options.textureArrays ? ".arrays" : ".png");
+
+		try
+		{
+			std::vector<std::string> filenames_out;
+			for(size_t i=0; i<arguments.size(); ++i)
+			{
+				filenames_out.push_back(arguments[i] + ".baked" + (options.binary ? ".bin" : ".obj"));
+			}
+			std::cout << "baking " << arguments.size() << " files into " << options.sharedAtlas << textureExtension << "...";
+			bakeObjsSharedAtlas(options, arguments, filenames_out, options.sharedAtlas + ".mtl", options.sharedAtlas + textureExtension);
+			std::cout << " done." << std::endl;
+			return 0;
+		}
+		catch(std::runtime_error& e)
+		{
+			std::cerr << e.what() << std::endl;
+			return -1;
+		}
+	}
+
+	std::string filename_in(arguments[0]);
 	std::string filename_out_base = filename_in + ".baked";
-	if (argc >=3)
+	if (arguments.size() >= 2)
 	{
-		filename_out_base = std::string(argv[2]);
+		filename_out_base = arguments[1];
 	}
 
 	try
 	{
-		std::string filename_out(filename_out_base + ".obj");
+		bool binary = options.binary && !options.streaming;
+		std::string filename_out(filename_out_base + (binary ? ".bin" : ".obj"));
 		std::string filename_mat(filename_out_base + ".mtl");
-		std::string filename_tex(filename_out_base + ".png");
-		Mesh mesh_in;
-		Mesh mesh_out;
-
-		// Read and parse input mesh
-		std::cout << "reading " << filename_in << "...";
-		loadObj(filename_in, mesh_in);
-		std::cout << " done." << std::endl;
+		std::string textureExtension = options.pageSize > 0 ? ".pages" : (options.textureArrays ? ".arrays" : ".png");
+		std::string filename_tex(filename_out_base + (options.streaming ? ".png" : textureExtension));
 
-		// Build texture atlas
-		std::cout << "baking " << "...";
-		packTextures(mesh_in, mesh_out, filename_tex);
-		std::cout << " done." << std::endl;
+		if (options.streaming)
+		{
+			if (options.lodCount > 0)
+			{
+				std::cerr << "levels of detail are not generated when streaming" << std::endl;
+			}
+			if (options.chunks)
+			{
+				std::cerr << "chunks are not generated when streaming" << std::endl;
+			}
+			if (options.binary)
+			{
+				std::cerr << "binary files are not written when streaming" << std::endl;
+			}
+			if (options.incremental)
+			{
+				std::cerr << "incremental bakes are not supported when streaming" << std::endl;
+			}
+			if (options.weld)
+			{
+				std::cerr << "vertices are not welded when streaming" << std::endl;
+			}
+			if (options.pageSize > 0)
+			{
+				std::cerr << "virtual texture pages are not written when streaming" << std::endl;
+			}
+			if (options.alphaTexels)
+			{
+				std::cerr << "faces are not split by transparency when streaming" << std::endl;
+			}
+			if (options.textureArrays)
+			{
+				std::cerr << "texture arrays are not written when streaming" << std::endl;
+			}
+			std::cout << "baking " << filename_in << " to " << filename_out << " (streaming)...";
+			bakeObjStreaming(options, filename_in, filename_out, filename_mat, filename_tex);
+			std::cout << " done." << std::endl;
+			return 0;
+		}
 
-		// Write output mesh
-		std::cout << "writing " << filename_out << "...";
-		writeObj(filename_out, filename_mat, mesh_out);
+		if (options.incremental && options.pageSize > 0)
+		{
+			std::cerr << "incremental bakes are not supported with virtual texture pages" << std::endl;
+		}
+		if (options.incremental && options.textureArrays)
+		{
+			std::cerr << "incremental bakes are not supported with texture arrays" << std::endl;
+		}
+		std::cout << "baking " << filename_in << " to " << filename_out << "...";
+		bakeObjPipelined(options, filename_in, filename_out, filename_mat, filename_tex);
 		std::cout << " done." << std::endl;
 
 		return 0;
@@ -0,0 +1,49 @@
+#ifndef BAKE_OBJ_H
+#define BAKE_OBJ_H
+
+#include "pngEncoder.h"
+
+#include <string>
+
+//! Command line options of the baker
+struct BakeOptions
+{
+	bool        streaming;    //!< Bake in two streaming passes without loading the mesh into memory
+	int         maxAtlasSize; //!< Maximum width and height of the atlas in pixels, 0 for no limit
+	int         lodCount;     //!< Number of simplified levels of detail written besides the baked mesh
+	bool        binary;       //!< Write the meshes as binary files instead of obj files
+	bool        quantize;     //!< Quantize the vertex attributes of binary files
+	int         normalBits;   //!< Bits per quantized octahedral normal component, 8 or 16
+	bool        meshlets;     //!< Split the faces of binary files into meshlets
+	bool        chunks;       //!< Split the baked mesh into spatial chunks drawable with 16-bit indices
+	bool        tangents;     //!< Write tangent frames for normal mapping into binary files
+	float       creaseAngle;  //!< Faces meeting at a sharper angle in degrees are not smoothed when generating normals
+	std::string sharedAtlas;  //!< Base filename of the atlas shared by all input files, empty to bake a single file
+	bool        weld;         //!< Merge vertices with matching positions, normals and texture coordinates after loading
+	bool        incremental;  //!< Write a layout sidecar and only update the atlas when just texture contents changed
+	int         pageSize;     //!< Write the atlas as virtual texture pages of this size instead of one image, 0 for one image
+	PngOptions  png;          //!< Compression level and row filters of the atlas image
+	bool        alphaTexels;  //!< Split opaque, alpha tested and blended faces by the alpha of their texels, not only by their materials
+	bool        textureArrays; //!< Write the used textures as layers of texture arrays bucketed by size instead of packing an atlas
+
+	BakeOptions()
+	{
+		streaming = false;
+		maxAtlasSize = 0;
+		lodCount = 0;
+		binary = false;
+		quantize = false;
+		normalBits = 16;
+		meshlets = false;
+		chunks = false;
+		tangents = false;
+		creaseAngle = 60.0f;
+		weld = false;
+		incremental = false;
+		pageSize = 0;
+		alphaTexels = false;
+		textureArrays = false;
+	}
+};
+
+#endif
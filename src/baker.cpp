@@ -0,0 +1,117 @@
+#include "baker.h"
+#include "parser.h"
+#include "packer.h"
+#include "taskQueue.h"
+#include "chunker.h"
+#include "pipeline.h"
+
+#include <sstream>
+#include <stdexcept>
+
+#include <boost/bind.hpp>
+
+//=================================================================================================
+// The atlas builder must outlive the task queue, whose worker thread uses it
+//=================================================================================================
+class BakerImpl
+{
+public:
+	AtlasBuilder mAtlas;
+	TaskQueue    mImageTasks;
+public:
+	void queueTextureDecoding(const MaterialMapType& materials)
+	{
+		mImageTasks.post(boost::bind(&AtlasBuilder::loadTextures, &mAtlas, materials));
+	}
+	//! Only the textures of the last bake are kept, so the cache does not grow with every texture ever baked
+	void releaseUnusedTextures()
+	{
+		mImageTasks.post(boost::bind(&AtlasBuilder::releaseUnusedTextures, &mAtlas));
+		mImageTasks.wait();
+	}
+	void bake(const BakeOptions& options, const std::string& objFilename, FileResolver& resolver, const std::string& outputName, BakeResult& result);
+};
+
+Baker::Baker()
+	: mImpl(new BakerImpl)
+{
+}
+
+void Baker::bake(const BakeOptions& options, const std::string& objFilename, FileResolver& resolver, const std::string& outputName, BakeResult& result)
+{
+	// Image tasks of a failed bake may still use the resolver, they have to finish before returning
+	try
+	{
+		mImpl->bake(options, objFilename, resolver, outputName, result);
+	}
+	catch(...)
+	{
+		try
+		{
+			mImpl->mImageTasks.wait();
+		}
+		catch(std::runtime_error&)
+		{
+		}
+		mImpl->mAtlas.setResolver(NULL);
+		mImpl->releaseUnusedTextures();
+		throw;
+	}
+	mImpl->mAtlas.setResolver(NULL);
+	mImpl->releaseUnusedTextures();
+}
+
+//=================================================================================================
+// Same stages as bakeObjPipelined, writing into memory buffers
+//=================================================================================================
+void BakerImpl::bake(const BakeOptions& options, const std::string& objFilename, FileResolver& resolver, const std::string& outputName, BakeResult& result)
+{
+	result.meshFilename = outputName + ".obj";
+	result.materialFilename = outputName + ".mtl";
+	result.atlasFilename = outputName + ".png";
+
+	boost::shared_ptr<std::istream> infile = resolver.open(objFilename);
+	if (!infile)
+	{
+		throw std::runtime_error("Unable to open mesh file: " + objFilename);
+	}
+
+	Mesh mesh;
+	mAtlas.setResolver(&resolver);
+	mAtlas.setMaxSize(options.maxAtlasSize);
+	mAtlas.setPngOptions(options.png);
+	loadObj(*infile, objFilename, resolver, mesh, boost::bind(&BakerImpl::queueTextureDecoding, this, _1), options.creaseAngle);
+	infile.reset();
+	if (options.weld)
+	{
+		weldMesh(mesh);
+	}
+
+	normalizeTexcoordRepeats(mesh);
+	MaterialUsageListType usedMaterials;
+	collectUsedMaterials(mesh, usedMaterials);
+	AtlasLayoutType layout;
+	AlphaModeListType alphaModes;
+	classifyMaterials(mesh, alphaModes);
+	mImageTasks.post(boost::bind(&AtlasBuilder::pack, &mAtlas, boost::cref(mesh.materials), boost::cref(mesh.materialNames), boost::cref(usedMaterials), boost::ref(layout)));
+	mImageTasks.post(boost::bind(&AtlasBuilder::classifyTexels, &mAtlas, boost::ref(alphaModes), options.alphaTexels));
+	mImageTasks.wait();
+
+	// Encode the atlas while the mesh is written
+	mImageTasks.post(boost::bind(&AtlasBuilder::saveToMemory, &mAtlas, boost::ref(result.atlas)));
+	bakeTexcoords(mesh, layout, alphaModes, result.atlasFilename);
+	if (options.chunks)
+	{
+		splitIntoChunks(mesh, maxChunkVertices);
+	}
+
+	std::ostringstream meshStream;
+	writeObj(meshStream, result.materialFilename, mesh);
+	result.mesh = meshStream.str();
+
+	std::ostringstream materialStream;
+	writeMaterialFile(materialStream, mesh.materials);
+	result.materials = materialStream.str();
+
+	mImageTasks.wait();
+}
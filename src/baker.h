@@ -0,0 +1,39 @@
+#ifndef BAKER_H
+#define BAKER_H
+
+#include "bakeObj.h"
+#include "resolver.h"
+
+#include <string>
+
+#include <boost/shared_ptr.hpp>
+
+//! Files produced by an in-memory bake, the filenames are the names the files reference each other by
+struct BakeResult
+{
+	std::string meshFilename;
+	std::string mesh;
+	std::string materialFilename;
+	std::string materials;
+	std::string atlasFilename;
+	std::string atlas;
+};
+
+class BakerImpl;
+
+//! Bakes obj files without touching the disk, all input files are opened through a resolver
+//! A baker keeps DevIL initialized and the decoded textures of the last bake,
+//! a texture is decoded again only when its contents changed.
+class Baker
+{
+private:
+	boost::shared_ptr<BakerImpl> mImpl;
+public:
+	Baker();
+	//! Bakes an obj file, its material libraries and textures are opened through the same resolver
+	//! The outputs are named outputName.obj, .mtl and .png. The mesh is always written as obj text,
+	//! levels of detail are not generated.
+	void bake(const BakeOptions& options, const std::string& objFilename, FileResolver& resolver, const std::string& outputName, BakeResult& result);
+};
+
+#endif
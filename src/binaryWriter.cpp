@@ -0,0 +1,498 @@
+#include "binaryWriter.h"
+#include "meshlets.h"
+#include "tangents.h"
+#include <iostream>
+#include <algorithm>
+#include <stdexcept>
+#include <cmath>
+
+// Version of the binary file format
+const unsigned int binaryVersion = 1;
+
+// Vertex attribute formats
+enum AttributeFormat
+{
+	FORMAT_FLOAT32     = 0,
+	FORMAT_UNORM16     = 1,
+	FORMAT_OCT_SNORM16 = 2,
+	FORMAT_OCT_SNORM8  = 3
+};
+
+//=================================================================================================
+// Binary file writer
+//=================================================================================================
+BinaryFileWriter::BinaryFileWriter(const std::string& filename)
+{
+	mSectionStart = -1;
+	mFile.open(filename.c_str(), std::ios::out | std::ios::binary);
+	if(!mFile.is_open())
+	{
+		throw std::runtime_error("Unable to open output mesh file: " + filename);
+	}
+	mFile.write("BOBJ", 4);
+	write(binaryVersion);
+}
+
+void BinaryFileWriter::beginSection(const char* tag)
+{
+	mFile.write(tag, 4);
+	write((unsigned int) 0);
+	mSectionStart = mFile.tellp();
+}
+
+void BinaryFileWriter::endSection()
+{
+	std::streamoff end = mFile.tellp();
+	unsigned int size = (unsigned int) (end - mSectionStart);
+	const char padding[4] = {0, 0, 0, 0};
+	mFile.write(padding, (4 - size%4) % 4);
+	std::streamoff paddedEnd = mFile.tellp();
+
+	// Patch the payload size
+	mFile.seekp(mSectionStart - std::streamoff(sizeof(unsigned int)));
+	size = (unsigned int) (paddedEnd - mSectionStart);
+	write(size);
+	mFile.seekp(paddedEnd);
+	mSectionStart = -1;
+}
+
+void BinaryFileWriter::write(const void* data, size_t size)
+{
+	mFile.write((const char*) data, (std::streamsize) size);
+}
+
+void BinaryFileWriter::writeString(const std::string& value)
+{
+	write((unsigned int) value.size());
+	write(value.data(), value.size());
+}
+
+void BinaryFileWriter::close()
+{
+	mFile.close();
+	if (mFile.fail())
+	{
+		throw std::runtime_error("Unable to write the binary mesh file");
+	}
+}
+
+//=================================================================================================
+// Octahedral normal encoding
+//=================================================================================================
+float signNotZero(float value)
+{
+	return value < 0.0f ? -1.0f : 1.0f;
+}
+
+void encodeOctahedral(const Vector3f& normal, float& x, float& y)
+{
+	const float* n = normal.data;
+	float sum = fabs(n[0]) + fabs(n[1]) + fabs(n[2]);
+	if (sum <= 0.0f)
+	{
+		x = y = 0.0f;
+		return;
+	}
+	x = n[0] / sum;
+	y = n[1] / sum;
+	if (n[2] < 0.0f)
+	{
+		float ox = x;
+		x = (1.0f - fabs(y)) * signNotZero(ox);
+		y = (1.0f - fabs(ox)) * signNotZero(y);
+	}
+}
+
+Vector3f decodeOctahedral(float x, float y)
+{
+	Vector3f normal;
+	float* n = normal.data;
+	n[0] = x;
+	n[1] = y;
+	n[2] = 1.0f - fabs(x) - fabs(y);
+	if (n[2] < 0.0f)
+	{
+		n[0] = (1.0f - fabs(y)) * signNotZero(x);
+		n[1] = (1.0f - fabs(x)) * signNotZero(y);
+	}
+	float length = sqrt(n[0]*n[0] + n[1]*n[1] + n[2]*n[2]);
+	for(int k=0; k<3; ++k)
+	{
+		n[k] /= length;
+	}
+	return normal;
+}
+
+//=================================================================================================
+// Angle between two vectors in radians
+//=================================================================================================
+double angleBetween(const Vector3f& a, const Vector3f& b)
+{
+	double cross[3] = {
+		double(a.data[1])*b.data[2] - double(a.data[2])*b.data[1],
+		double(a.data[2])*b.data[0] - double(a.data[0])*b.data[2],
+		double(a.data[0])*b.data[1] - double(a.data[1])*b.data[0]};
+	double dot = double(a.data[0])*b.data[0] + double(a.data[1])*b.data[1] + double(a.data[2])*b.data[2];
+	return atan2(sqrt(cross[0]*cross[0] + cross[1]*cross[1] + cross[2]*cross[2]), dot);
+}
+
+//=================================================================================================
+// Quantizes a normal to the octahedral grid point closest in angle
+// Returns the angle between the normal and the decoded normal
+//=================================================================================================
+double quantizeNormal(const Vector3f& normal, int maxValue, int quantized[2])
+{
+	if (normal.data[0] == 0.0f && normal.data[1] == 0.0f && normal.data[2] == 0.0f)
+	{
+		quantized[0] = quantized[1] = 0;
+		return 0.0;
+	}
+
+	float x, y;
+	encodeOctahedral(normal, x, y);
+	float bx = floor(x * maxValue);
+	float by = floor(y * maxValue);
+
+	// Try the four surrounding grid points
+	double bestAngle = 4.0;
+	for(int i=0; i<4; ++i)
+	{
+		int qx = std::max(-maxValue, std::min(maxValue, (int) bx + (i&1)));
+		int qy = std::max(-maxValue, std::min(maxValue, (int) by + (i>>1)));
+		double angle = angleBetween(decodeOctahedral(qx / float(maxValue), qy / float(maxValue)), normal);
+		if (angle < bestAngle)
+		{
+			bestAngle = angle;
+			quantized[0] = qx;
+			quantized[1] = qy;
+		}
+	}
+	return bestAngle;
+}
+
+//=================================================================================================
+// Attribute sections
+//=================================================================================================
+void writePositions(BinaryFileWriter& writer, const std::vector<Vector3f>& vertices, bool quantize, double& maxError)
+{
+	writer.beginSection("VPOS");
+	writer.write((unsigned int) vertices.size());
+	maxError = 0.0;
+	if (!quantize)
+	{
+		writer.write((unsigned int) FORMAT_FLOAT32);
+		writer.writeArray(vertices);
+		writer.endSection();
+		return;
+	}
+
+	Vector3f minimum = vertices.empty() ? Vector3f() : vertices[0];
+	Vector3f maximum = minimum;
+	for(size_t i=1; i<vertices.size(); ++i)
+	{
+		for(int k=0; k<3; ++k)
+		{
+			minimum.data[k] = std::min(minimum.data[k], vertices[i].data[k]);
+			maximum.data[k] = std::max(maximum.data[k], vertices[i].data[k]);
+		}
+	}
+	writer.write((unsigned int) FORMAT_UNORM16);
+	writer.write(minimum);
+	writer.write(maximum);
+
+	std::vector<unsigned short> quantized(3*vertices.size());
+	for(size_t i=0; i<vertices.size(); ++i)
+	{
+		for(int k=0; k<3; ++k)
+		{
+			double extent = maximum.data[k] - minimum.data[k];
+			double scale = extent > 0.0 ? 65535.0 / extent : 0.0;
+			int q = (int) floor((vertices[i].data[k] - minimum.data[k]) * scale + 0.5);
+			quantized[3*i+k] = (unsigned short) std::max(0, std::min(65535, q));
+
+			double decoded = minimum.data[k] + quantized[3*i+k] * extent / 65535.0;
+			maxError = std::max(maxError, fabs(decoded - vertices[i].data[k]));
+		}
+	}
+	writer.writeArray(quantized);
+	writer.endSection();
+}
+
+//=================================================================================================
+// Writes unit vectors octahedral encoded, returns the maximum error in degrees
+//=================================================================================================
+double writeOctahedral(BinaryFileWriter& writer, const std::vector<Vector3f>& normals, int normalBits)
+{
+	int maxValue = normalBits == 8 ? 127 : 32767;
+	std::vector<int> quantized(2*normals.size());
+	double maxAngle = 0.0;
+	#pragma omp parallel
+	{
+		double threadMaxAngle = 0.0;
+		#pragma omp for
+		for(int i=0; i<(int) normals.size(); ++i)
+		{
+			threadMaxAngle = std::max(threadMaxAngle, quantizeNormal(normals[i], maxValue, &quantized[2*i]));
+		}
+		#pragma omp critical
+		maxAngle = std::max(maxAngle, threadMaxAngle);
+	}
+
+	if (normalBits == 8)
+	{
+		std::vector<signed char> packed(quantized.begin(), quantized.end());
+		writer.writeArray(packed);
+	}
+	else
+	{
+		std::vector<short> packed(quantized.begin(), quantized.end());
+		writer.writeArray(packed);
+	}
+	return maxAngle * 180.0 / 3.14159265358979323846;
+}
+
+void writeNormals(BinaryFileWriter& writer, const std::vector<Vector3f>& normals, bool quantize, int normalBits, double& maxError)
+{
+	writer.beginSection("VNRM");
+	writer.write((unsigned int) normals.size());
+	maxError = 0.0;
+	if (!quantize)
+	{
+		writer.write((unsigned int) FORMAT_FLOAT32);
+		writer.writeArray(normals);
+		writer.endSection();
+		return;
+	}
+
+	writer.write((unsigned int) (normalBits == 8 ? FORMAT_OCT_SNORM8 : FORMAT_OCT_SNORM16));
+	maxError = writeOctahedral(writer, normals, normalBits);
+	writer.endSection();
+}
+
+//=================================================================================================
+// Tangents with bitangent signs, quantized as octahedral directions followed by one signed byte per sign
+//=================================================================================================
+void writeTangents(BinaryFileWriter& writer, const std::vector<Vector4f>& tangents, bool quantize, int normalBits, double& maxError)
+{
+	writer.beginSection("TANG");
+	writer.write((unsigned int) tangents.size());
+	maxError = 0.0;
+	if (!quantize)
+	{
+		writer.write((unsigned int) FORMAT_FLOAT32);
+		writer.writeArray(tangents);
+		writer.endSection();
+		return;
+	}
+
+	writer.write((unsigned int) (normalBits == 8 ? FORMAT_OCT_SNORM8 : FORMAT_OCT_SNORM16));
+	std::vector<Vector3f> directions(tangents.size());
+	std::vector<signed char> signs(tangents.size());
+	for(size_t i=0; i<tangents.size(); ++i)
+	{
+		std::copy(tangents[i].data, tangents[i].data+3, directions[i].data);
+		signs[i] = tangents[i].data[3] < 0.0f ? -1 : 1;
+	}
+	maxError = writeOctahedral(writer, directions, normalBits);
+	writer.writeArray(signs);
+	writer.endSection();
+}
+
+void writeTexcoords(BinaryFileWriter& writer, const std::vector<Vector2f>& texcoord, bool quantize, double& maxError)
+{
+	writer.beginSection("VTEX");
+	writer.write((unsigned int) texcoord.size());
+	maxError = 0.0;
+	if (!quantize)
+	{
+		writer.write((unsigned int) FORMAT_FLOAT32);
+		writer.writeArray(texcoord);
+		writer.endSection();
+		return;
+	}
+
+	// Baked texture coordinates are inside [0,1], 1 itself is stored as the last step below it
+	writer.write((unsigned int) FORMAT_UNORM16);
+	std::vector<unsigned short> quantized(2*texcoord.size());
+	for(size_t i=0; i<texcoord.size(); ++i)
+	{
+		for(int k=0; k<2; ++k)
+		{
+			int q = (int) floor(texcoord[i].data[k] * 65536.0 + 0.5);
+			quantized[2*i+k] = (unsigned short) std::max(0, std::min(65535, q));
+			maxError = std::max(maxError, fabs(quantized[2*i+k] / 65536.0 - texcoord[i].data[k]));
+		}
+	}
+	writer.writeArray(quantized);
+	writer.endSection();
+}
+
+//=================================================================================================
+// Chunk section
+//=================================================================================================
+void writeChunks(BinaryFileWriter& writer, const Mesh& mesh)
+{
+	writer.beginSection("CHNK");
+	writer.write((unsigned int) mesh.components.size());
+
+	std::vector<unsigned short> indices;
+	for(ComponentListType::const_iterator ic=mesh.components.begin(); ic!=mesh.components.end(); ++ic)
+	{
+		int firstVertex = (int) mesh.vertices.size();
+		int lastVertex = 0;
+		for(size_t f=0; f<ic->faces.size(); ++f)
+		{
+			for(int k=0; k<3; ++k)
+			{
+				firstVertex = std::min(firstVertex, ic->faces[f].data[k]);
+				lastVertex = std::max(lastVertex, ic->faces[f].data[k] + 1);
+			}
+		}
+		if (ic->faces.empty())
+		{
+			firstVertex = lastVertex = 0;
+		}
+		if (lastVertex - firstVertex > 65536)
+		{
+			throw std::runtime_error("component " + ic->componentName + " uses too many vertices for 16-bit indices");
+		}
+
+		Vector3f minimum, maximum;
+		for(int i=firstVertex; i<lastVertex; ++i)
+		{
+			for(int k=0; k<3; ++k)
+			{
+				minimum.data[k] = i==firstVertex ? mesh.vertices[i].data[k] : std::min(minimum.data[k], mesh.vertices[i].data[k]);
+				maximum.data[k] = i==firstVertex ? mesh.vertices[i].data[k] : std::max(maximum.data[k], mesh.vertices[i].data[k]);
+			}
+		}
+
+		writer.write((unsigned int) firstVertex);
+		writer.write((unsigned int) (lastVertex - firstVertex));
+		writer.write((unsigned int) indices.size());
+		writer.write((unsigned int) (3*ic->faces.size()));
+		writer.write(minimum);
+		writer.write(maximum);
+		for(size_t f=0; f<ic->faces.size(); ++f)
+		{
+			for(int k=0; k<3; ++k)
+			{
+				indices.push_back((unsigned short) (ic->faces[f].data[k] - firstVertex));
+			}
+		}
+	}
+	writer.writeArray(indices);
+	writer.endSection();
+}
+
+//=================================================================================================
+// Writes a mesh to a binary file
+//=================================================================================================
+void writeBinaryMesh(const std::string& filename, const std::string& matFilename, const Mesh& mesh, const BinaryLayout& layout)
+{
+	if(mesh.vertices.size()==0)
+	{
+		throw std::runtime_error("mesh contains no vertices");
+	}
+	if (!mesh.normals.empty() && mesh.normals.size() != mesh.vertices.size())
+	{
+		throw std::runtime_error("inconsistent number of normals");
+	}
+	if (!mesh.texcoord.empty() && mesh.texcoord.size() != mesh.vertices.size())
+	{
+		throw std::runtime_error("inconsistent number of vertex coordinates");
+	}
+
+	BinaryFileWriter writer(filename);
+
+	writer.beginSection("MTLL");
+	writer.writeString(matFilename);
+	writer.endSection();
+
+	double positionError = 0.0;
+	double normalError = 0.0;
+	double texcoordError = 0.0;
+	double tangentError = 0.0;
+	writePositions(writer, mesh.vertices, layout.quantize, positionError);
+	if (!mesh.normals.empty())
+	{
+		writeNormals(writer, mesh.normals, layout.quantize, layout.normalBits, normalError);
+	}
+	if (!mesh.texcoord.empty())
+	{
+		writeTexcoords(writer, mesh.texcoord, layout.quantize, texcoordError);
+	}
+
+	// Tangents of the final texture coordinates, meshes without normals or texture coordinates have none
+	std::vector<Vector4f> tangents;
+	if (layout.tangents)
+	{
+		generateTangents(mesh, tangents);
+		if (!tangents.empty())
+		{
+			writeTangents(writer, tangents, layout.quantize, layout.normalBits, tangentError);
+		}
+	}
+
+	// Indices of all components, followed by the index range of each component
+	writer.beginSection("INDX");
+	unsigned int indexCount = 0;
+	for(ComponentListType::const_iterator ic=mesh.components.begin(); ic!=mesh.components.end(); ++ic)
+	{
+		indexCount += (unsigned int) (3*ic->faces.size());
+	}
+	writer.write(indexCount);
+	for(ComponentListType::const_iterator ic=mesh.components.begin(); ic!=mesh.components.end(); ++ic)
+	{
+		writer.writeArray(ic->faces);
+	}
+	writer.endSection();
+
+	writer.beginSection("CMPS");
+	writer.write((unsigned int) mesh.components.size());
+	unsigned int firstIndex = 0;
+	for(ComponentListType::const_iterator ic=mesh.components.begin(); ic!=mesh.components.end(); ++ic)
+	{
+		writer.writeString(ic->componentName);
+		writer.writeString(mesh.materialNames[ic->materialId]);
+		writer.write(firstIndex);
+		writer.write((unsigned int) (3*ic->faces.size()));
+		firstIndex += (unsigned int) (3*ic->faces.size());
+	}
+	writer.endSection();
+
+	// Chunks: vertex range, index range and bounds of each component, followed by 16-bit indices relative to the range
+	if (layout.chunks)
+	{
+		writeChunks(writer, mesh);
+	}
+
+	// Meshlets: the meshlet records, their vertex indices and their local triangle indices
+	if (layout.meshlets)
+	{
+		MeshletList meshlets;
+		buildMeshlets(mesh, layout.meshletVertices, layout.meshletTriangles, meshlets);
+		writer.beginSection("MSHL");
+		writer.write((unsigned int) meshlets.meshlets.size());
+		writer.write((unsigned int) meshlets.vertices.size());
+		writer.write((unsigned int) (meshlets.triangles.size() / 3));
+		writer.writeArray(meshlets.meshlets);
+		writer.writeArray(meshlets.vertices);
+		writer.writeArray(meshlets.triangles);
+		writer.endSection();
+	}
+	writer.close();
+
+	if (layout.quantize)
+	{
+		size_t floatSize = mesh.vertices.size()*sizeof(Vector3f) + mesh.normals.size()*sizeof(Vector3f) + mesh.texcoord.size()*sizeof(Vector2f) + tangents.size()*sizeof(Vector4f);
+		size_t quantizedSize = mesh.vertices.size()*6 + mesh.normals.size()*(layout.normalBits == 8 ? 2 : 4) + mesh.texcoord.size()*4 + tangents.size()*(layout.normalBits == 8 ? 3 : 5);
+		std::cerr << "quantized vertex data from " << floatSize << " to " << quantizedSize << " bytes, maximum errors: "
+			<< "position " << positionError << ", normal " << normalError << " degrees, texture coordinate " << texcoordError;
+		if (!tangents.empty())
+		{
+			std::cerr << ", tangent " << tangentError << " degrees";
+		}
+		std::cerr << std::endl;
+	}
+}
@@ -0,0 +1,64 @@
+#ifndef BINARY_WRITER_H
+#define BINARY_WRITER_H
+
+#include "objTypes.h"
+#include <fstream>
+
+//! Vertex attribute encodings of the binary mesh file
+struct BinaryLayout
+{
+	bool quantize;   //!< Store 16-bit positions and texture coordinates and octahedral normals
+	int  normalBits; //!< Bits per octahedral normal component when quantizing, 8 or 16
+	bool meshlets;   //!< Also write the faces split into meshlets with culling bounds
+	int  meshletVertices;
+	int  meshletTriangles;
+	bool chunks;     //!< Also write 16-bit indices relative to the vertex range of each component
+	bool tangents;   //!< Also write a tangent and bitangent sign per vertex
+
+	BinaryLayout()
+	{
+		quantize = false;
+		normalBits = 16;
+		meshlets = false;
+		meshletVertices = 64;
+		meshletTriangles = 124;
+		chunks = false;
+		tangents = false;
+	}
+};
+
+//! Writes a binary file made of tagged sections
+//! The file starts with the magic "BOBJ" and a version, each section with a four character tag
+//! and the size of its payload. Payloads are padded to multiples of 4 bytes, all values are little endian.
+class BinaryFileWriter
+{
+private:
+	std::ofstream  mFile;
+	std::streamoff mSectionStart;
+public:
+	BinaryFileWriter(const std::string& filename);
+	void beginSection(const char* tag);
+	void endSection();
+	void write(const void* data, size_t size);
+	template<typename T> void write(const T& value)
+	{
+		write(&value, sizeof(T));
+	}
+	template<typename T> void writeArray(const std::vector<T>& values)
+	{
+		if (!values.empty())
+		{
+			write(&values[0], values.size()*sizeof(T));
+		}
+	}
+	void writeString(const std::string& value);
+	void close();
+};
+
+//! Writes a mesh with single indexed vertices to a binary file
+//! Positions are quantized relative to the mesh bounds, normals are octahedral encoded, and
+//! texture coordinates are stored as multiples of 1/65536, which keeps the texel edges of any
+//! power of two atlas up to 65536 pixels exact. The maximum errors are reported on std::cerr.
+void writeBinaryMesh(const std::string& filename, const std::string& matFilename, const Mesh& mesh, const BinaryLayout& layout);
+
+#endif
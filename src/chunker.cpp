@@ -0,0 +1,174 @@
+#include "chunker.h"
+#include <algorithm>
+#include <sstream>
+
+//=================================================================================================
+// Compares faces by the coordinate of their center along one axis
+//=================================================================================================
+struct FaceCenterLess
+{
+	const std::vector<Vector3f>& centers;
+	int axis;
+	FaceCenterLess(const std::vector<Vector3f>& centers, int axis) : centers(centers), axis(axis) {}
+	bool operator()(int a, int b) const
+	{
+		return centers[a].data[axis] < centers[b].data[axis];
+	}
+};
+
+//=================================================================================================
+// Counts the distinct vertices of a range of faces
+//=================================================================================================
+int countVertices(const std::vector<Vector3i>& faces, const int* first, const int* last, std::vector<int>& vertexMark, int mark)
+{
+	int count = 0;
+	for(const int* f=first; f!=last; ++f)
+	{
+		for(int k=0; k<3; ++k)
+		{
+			int& vertexMarked = vertexMark[faces[*f].data[k]];
+			if (vertexMarked != mark)
+			{
+				vertexMarked = mark;
+				count++;
+			}
+		}
+	}
+	return count;
+}
+
+//=================================================================================================
+// Splits the faces of one component into ranges of at most maxVertices vertices
+// The face order is changed so that each range is one chunk.
+//=================================================================================================
+void splitFaces(const Mesh& mesh, const std::vector<Vector3i>& faces, int maxVertices, std::vector<int>& order, std::vector<size_t>& chunkEnds)
+{
+	std::vector<Vector3f> centers(faces.size());
+	order.resize(faces.size());
+	for(size_t f=0; f<faces.size(); ++f)
+	{
+		order[f] = (int) f;
+		for(int k=0; k<3; ++k)
+		{
+			centers[f].data[k] = (mesh.vertices[faces[f].data[0]].data[k] + mesh.vertices[faces[f].data[1]].data[k] + mesh.vertices[faces[f].data[2]].data[k]) / 3.0f;
+		}
+	}
+
+	std::vector<int> vertexMark(mesh.vertices.size(), -1);
+	int mark = 0;
+
+	// Depth first, so the chunks end up in face order
+	std::vector<std::pair<size_t, size_t> > ranges;
+	ranges.push_back(std::make_pair((size_t) 0, faces.size()));
+	chunkEnds.clear();
+	while(!ranges.empty())
+	{
+		size_t first = ranges.back().first;
+		size_t last = ranges.back().second;
+		ranges.pop_back();
+		if (first == last)
+		{
+			continue;
+		}
+		int* begin = &order[0];
+		if (last - first == 1 || countVertices(faces, begin+first, begin+last, vertexMark, mark++) <= maxVertices)
+		{
+			chunkEnds.push_back(last);
+			continue;
+		}
+
+		// Split at the median along the longest axis of the face centers
+		Vector3f minimum = centers[order[first]];
+		Vector3f maximum = minimum;
+		for(size_t i=first+1; i<last; ++i)
+		{
+			for(int k=0; k<3; ++k)
+			{
+				minimum.data[k] = std::min(minimum.data[k], centers[order[i]].data[k]);
+				maximum.data[k] = std::max(maximum.data[k], centers[order[i]].data[k]);
+			}
+		}
+		int axis = 0;
+		for(int k=1; k<3; ++k)
+		{
+			if (maximum.data[k] - minimum.data[k] > maximum.data[axis] - minimum.data[axis])
+			{
+				axis = k;
+			}
+		}
+		size_t middle = first + (last - first) / 2;
+		std::nth_element(begin+first, begin+middle, begin+last, FaceCenterLess(centers, axis));
+		ranges.push_back(std::make_pair(middle, last));
+		ranges.push_back(std::make_pair(first, middle));
+	}
+}
+
+//=================================================================================================
+// Splits each component into chunks with contiguous vertex ranges
+//=================================================================================================
+void splitIntoChunks(Mesh& mesh, int maxVertices)
+{
+	bool hasNormals = mesh.normals.size() == mesh.vertices.size();
+	bool hasTexCoord = mesh.texcoord.size() == mesh.vertices.size();
+
+	ComponentListType chunks;
+	std::vector<Vector3f> vertices;
+	std::vector<Vector3f> normals;
+	std::vector<Vector2f> texcoord;
+	std::vector<int> vertexMap(mesh.vertices.size(), -1);
+	std::vector<int> order;
+	std::vector<size_t> chunkEnds;
+	for(ComponentListType::const_iterator ic=mesh.components.begin(); ic!=mesh.components.end(); ++ic)
+	{
+		splitFaces(mesh, ic->faces, maxVertices, order, chunkEnds);
+
+		size_t first = 0;
+		for(size_t c=0; c<chunkEnds.size(); ++c)
+		{
+			MeshComponent chunk;
+			chunk.materialId = ic->materialId;
+			chunk.componentName = ic->componentName;
+			if (chunkEnds.size() > 1)
+			{
+				std::ostringstream name;
+				name << ic->componentName << "_" << c;
+				chunk.componentName = name.str();
+			}
+
+			// Copy the vertices of the chunk to its own range
+			size_t firstVertex = vertices.size();
+			chunk.faces.resize(chunkEnds[c] - first);
+			for(size_t i=first; i<chunkEnds[c]; ++i)
+			{
+				Vector3i face = ic->faces[order[i]];
+				for(int k=0; k<3; ++k)
+				{
+					int& mapped = vertexMap[face.data[k]];
+					if (mapped < (int) firstVertex)
+					{
+						mapped = (int) vertices.size();
+						vertices.push_back(mesh.vertices[face.data[k]]);
+						if (hasNormals)
+						{
+							normals.push_back(mesh.normals[face.data[k]]);
+						}
+						if (hasTexCoord)
+						{
+							texcoord.push_back(mesh.texcoord[face.data[k]]);
+						}
+					}
+					face.data[k] = mapped;
+				}
+				chunk.faces[i - first] = face;
+			}
+			first = chunkEnds[c];
+			chunks.push_back(MeshComponent());
+			std::swap(chunks.back(), chunk);
+		}
+	}
+
+	mesh.components.swap(chunks);
+	mesh.vertices.swap(vertices);
+	mesh.normals.swap(normals);
+	mesh.texcoord.swap(texcoord);
+}
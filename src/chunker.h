@@ -0,0 +1,15 @@
+#ifndef CHUNKER_H
+#define CHUNKER_H
+
+#include "objTypes.h"
+
+// Maximum number of vertices of a chunk, one less than 65536 so the largest index can be used as restart index
+const int maxChunkVertices = 65535;
+
+//! Splits each component into spatially coherent chunks of at most maxVertices vertices
+//! The faces are split at the median of their centers along the longest axis until each part
+//! is small enough. Every chunk becomes a component with a contiguous range of vertices, so it
+//! can be drawn with 16-bit indices relative to its first vertex. Vertices on chunk borders are duplicated.
+void splitIntoChunks(Mesh& mesh, int maxVertices);
+
+#endif
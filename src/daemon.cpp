@@ -0,0 +1,164 @@
+#include "daemon.h"
+#include "baker.h"
+
+#include <iostream>
+#include <cstdio>
+#include <stdexcept>
+
+#include <boost/asio.hpp>
+
+#if defined(BOOST_ASIO_HAS_LOCAL_SOCKETS)
+
+typedef boost::asio::local::stream_protocol::socket SocketType;
+
+// Largest number of files, file name and total size of the files accepted in a request
+const unsigned int maxRequestFiles = 4096;
+const unsigned int maxRequestNameSize = 4096;
+const unsigned int maxRequestSize = 1u << 30;
+
+// Status codes of a response
+const unsigned int statusSuccess = 0;
+const unsigned int statusError = 1;
+
+//=================================================================================================
+// Request and response framing
+//=================================================================================================
+unsigned int readLength(SocketType& socket)
+{
+	unsigned char bytes[4];
+	boost::asio::read(socket, boost::asio::buffer(bytes, sizeof(bytes)));
+	return bytes[0] | (bytes[1] << 8) | (bytes[2] << 16) | ((unsigned int) bytes[3] << 24);
+}
+
+void readString(SocketType& socket, std::string& data, unsigned int maxLength)
+{
+	unsigned int length = readLength(socket);
+	if (length > maxLength)
+	{
+		throw std::runtime_error("request file too large");
+	}
+	data.resize(length);
+	if (length > 0)
+	{
+		boost::asio::read(socket, boost::asio::buffer(&data[0], length));
+	}
+}
+
+void appendLength(std::string& response, size_t length)
+{
+	for(int i=0; i<4; ++i)
+	{
+		response.push_back(char((length >> (8*i)) & 0xff));
+	}
+}
+
+void appendString(std::string& response, const std::string& data)
+{
+	appendLength(response, data.size());
+	response.append(data);
+}
+
+//=================================================================================================
+// Reads one request, bakes it and sends the response
+// Errors of the bake are sent to the client, connection and framing errors are thrown.
+//=================================================================================================
+void serveRequest(const BakeOptions& options, Baker& baker, SocketType& socket)
+{
+	unsigned int fileCount = readLength(socket);
+	if (fileCount == 0)
+	{
+		throw std::runtime_error("request without obj file");
+	}
+	if (fileCount > maxRequestFiles)
+	{
+		throw std::runtime_error("request with too many files");
+	}
+
+	// Files missing from the request are only opened below the working directory of the daemon
+	DiskFileResolver diskResolver(".");
+	MemoryFileResolver resolver(&diskResolver);
+	std::string objFilename;
+	unsigned int remainingSize = maxRequestSize;
+	for(unsigned int i=0; i<fileCount; ++i)
+	{
+		std::string name;
+		std::string data;
+		readString(socket, name, maxRequestNameSize);
+		readString(socket, data, remainingSize);
+		remainingSize -= (unsigned int) data.size();
+		if (i == 0)
+		{
+			objFilename = name;
+		}
+		resolver.addFile(name, data);
+	}
+
+	std::string response;
+	try
+	{
+		BakeResult result;
+		baker.bake(options, objFilename, resolver, objFilename + ".baked", result);
+		appendLength(response, statusSuccess);
+		appendLength(response, 3);
+		appendString(response, result.meshFilename);
+		appendString(response, result.mesh);
+		appendString(response, result.materialFilename);
+		appendString(response, result.materials);
+		appendString(response, result.atlasFilename);
+		appendString(response, result.atlas);
+	}
+	catch(std::exception& e)
+	{
+		response.clear();
+		appendLength(response, statusError);
+		appendString(response, e.what());
+	}
+	boost::asio::write(socket, boost::asio::buffer(response));
+}
+
+//=================================================================================================
+// Accepts one connection after the other, all of them bake with the same baker
+//=================================================================================================
+void runBakeDaemon(const BakeOptions& options, const std::string& socketPath)
+{
+	typedef boost::asio::local::stream_protocol ProtocolType;
+
+	// A socket file left behind by a previous daemon would make binding fail
+	std::remove(socketPath.c_str());
+
+	boost::asio::io_service ioService;
+	ProtocolType::acceptor acceptor(ioService, ProtocolType::endpoint(socketPath));
+	Baker baker;
+	for(;;)
+	{
+		SocketType socket(ioService);
+		acceptor.accept(socket);
+		try
+		{
+			for(;;)
+			{
+				serveRequest(options, baker, socket);
+			}
+		}
+		catch(boost::system::system_error& e)
+		{
+			if (e.code() != boost::asio::error::eof)
+			{
+				std::cerr << "connection failed: " << e.what() << std::endl;
+			}
+		}
+		catch(std::exception& e)
+		{
+			std::cerr << "invalid request: " << e.what() << std::endl;
+		}
+	}
+}
+
+#else
+
+void runBakeDaemon(const BakeOptions& options, const std::string& socketPath)
+{
+	throw std::runtime_error("local sockets are not supported on this platform");
+}
+
+#endif
@@ -0,0 +1,19 @@
+#ifndef DAEMON_H
+#define DAEMON_H
+
+#include "bakeObj.h"
+
+#include <string>
+
+//! Serves bake requests on a local socket until the process is terminated
+//! All integers are 32-bit little endian. A request is a file count followed by the files, each one
+//! a name length, the name, a data length and the data. The first file is the obj file, the others
+//! are its material libraries and textures, named relative to the files referencing them. Files missing
+//! from the request are read from disk, only below the working directory of the daemon.
+//! Requests with more than 4096 files, names longer than 4096 bytes or more than 1 GB of data close the connection.
+//! A response is a status, 0 on success, followed by the baked obj, mtl and png files in the same
+//! layout as the request, or by the length and text of an error message.
+//! Requests of one connection are answered in order, the connection is kept open until the client closes it.
+void runBakeDaemon(const BakeOptions& options, const std::string& socketPath);
+
+#endif
@@ -0,0 +1,399 @@
+#include "inputStream.h"
+
+#include <fstream>
+#include <vector>
+#include <algorithm>
+#include <stdexcept>
+
+#include <boost/scoped_ptr.hpp>
+#include <boost/thread.hpp>
+#include <boost/iostreams/filtering_stream.hpp>
+#include <boost/iostreams/device/file.hpp>
+#include <boost/iostreams/filter/gzip.hpp>
+#include <boost/iostreams/filter/newline.hpp>
+
+#include <zstd.h>
+
+enum CompressionType
+{
+	COMPRESSION_NONE,
+	COMPRESSION_GZIP,
+	COMPRESSION_ZSTD
+};
+
+// ------------------------------------------------------------------------------
+// Stream buffer that reads its source on a separate thread
+// Two buffers are used: one is filled by the thread while the other one is read.
+// ------------------------------------------------------------------------------
+class ReadAheadBuffer: public std::streambuf
+{
+private:
+	static const std::streamsize BufferSize = 1 << 20;
+	std::istream&             mSource;
+	std::vector<char>         mBuffers[2];
+	std::streamsize           mSizes[2];
+	bool                      mFull[2];
+	int                       mCurrent;
+	bool                      mEof;
+	bool                      mStop;
+	std::string               mError;
+	boost::mutex              mMutex;
+	boost::condition_variable mCondition;
+	boost::thread             mThread;
+public:
+	ReadAheadBuffer(std::istream& source)
+		: mSource(source)
+	{
+		for(int i=0; i<2; ++i)
+		{
+			mBuffers[i].resize(BufferSize);
+			mSizes[i] = 0;
+			mFull[i] = false;
+		}
+		mCurrent = -1;
+		mEof = false;
+		mStop = false;
+		mThread = boost::thread(&ReadAheadBuffer::run, this);
+	}
+	~ReadAheadBuffer()
+	{
+		{
+			boost::mutex::scoped_lock lock(mMutex);
+			mStop = true;
+		}
+		mCondition.notify_all();
+		mThread.join();
+	}
+protected:
+	virtual int_type underflow()
+	{
+		if (gptr() < egptr())
+		{
+			return traits_type::to_int_type(*gptr());
+		}
+		if (mEof)
+		{
+			return traits_type::eof();
+		}
+
+		boost::mutex::scoped_lock lock(mMutex);
+
+		// Hand the consumed buffer back to the reading thread
+		int next = 0;
+		if (mCurrent >= 0)
+		{
+			mFull[mCurrent] = false;
+			next = 1 - mCurrent;
+			mCondition.notify_all();
+		}
+
+		while(!mFull[next])
+		{
+			mCondition.wait(lock);
+		}
+		mCurrent = next;
+
+		if (!mError.empty())
+		{
+			mEof = true;
+			throw std::runtime_error(mError);
+		}
+		if (mSizes[next] == 0)
+		{
+			mEof = true;
+			return traits_type::eof();
+		}
+
+		char* data = &mBuffers[next][0];
+		setg(data, data, data + mSizes[next]);
+		return traits_type::to_int_type(*gptr());
+	}
+private:
+	void run()
+	{
+		int index = 0;
+		while(true)
+		{
+			{
+				boost::mutex::scoped_lock lock(mMutex);
+				while(!mStop && mFull[index])
+				{
+					mCondition.wait(lock);
+				}
+				if (mStop)
+				{
+					return;
+				}
+			}
+
+			std::streamsize size = 0;
+			std::string error;
+			try
+			{
+				mSource.read(&mBuffers[index][0], BufferSize);
+				size = mSource.gcount();
+			}
+			catch(std::exception& e)
+			{
+				error = std::string("could not decompress input: ") + e.what();
+			}
+
+			{
+				boost::mutex::scoped_lock lock(mMutex);
+				mSizes[index] = size;
+				mError = error;
+				mFull[index] = true;
+			}
+			mCondition.notify_all();
+
+			if (size == 0 || !error.empty())
+			{
+				return;
+			}
+			index = 1 - index;
+		}
+	}
+};
+
+// ------------------------------------------------------------------------------
+// Stream buffer decompressing a zstd file, independent frames are decompressed on all cores
+// Frames are collected into batches, which only works for frames that store their decompressed size.
+// Other frames and frames larger than a batch are decompressed as a stream.
+// ------------------------------------------------------------------------------
+class ZstdFrameBuffer: public std::streambuf
+{
+private:
+	static const size_t InputBatchSize = 16 << 20;
+	static const size_t OutputBatchSize = 64 << 20;
+	std::ifstream     mFile;
+	std::vector<char> mInput;
+	size_t            mInputStart;
+	size_t            mInputEnd;
+	std::vector<char> mOutput;
+	ZSTD_DStream*     mStream;
+	bool              mStreaming;  //!< A frame that did not fit a batch is being decompressed
+public:
+	ZstdFrameBuffer(const std::string& filename)
+		: mFile(filename.c_str(), std::ios::in | std::ios::binary)
+	{
+		if (!mFile.is_open())
+		{
+			throw std::runtime_error("could not open input file " + filename);
+		}
+		mInput.resize(InputBatchSize);
+		mInputStart = 0;
+		mInputEnd = 0;
+		mStream = ZSTD_createDStream();
+		mStreaming = false;
+	}
+	~ZstdFrameBuffer()
+	{
+		ZSTD_freeDStream(mStream);
+	}
+protected:
+	virtual int_type underflow()
+	{
+		while(gptr() == egptr())
+		{
+			if (mStreaming)
+			{
+				streamFrame();
+			}
+			else if (!decompressBatch())
+			{
+				return traits_type::eof();
+			}
+		}
+		return traits_type::to_int_type(*gptr());
+	}
+private:
+	//! Moves the unread input to the front and fills the rest of the input buffer from the file
+	void fillInput()
+	{
+		std::copy(mInput.begin() + mInputStart, mInput.begin() + mInputEnd, mInput.begin());
+		mInputEnd -= mInputStart;
+		mInputStart = 0;
+		while(mInputEnd < mInput.size() && mFile)
+		{
+			mFile.read(&mInput[mInputEnd], mInput.size() - mInputEnd);
+			mInputEnd += size_t(mFile.gcount());
+		}
+	}
+	//! Decompresses the complete frames at the start of the input concurrently, returns false at the end of the file
+	bool decompressBatch()
+	{
+		fillInput();
+		if (mInputStart == mInputEnd)
+		{
+			return false;
+		}
+
+		std::vector<size_t> frameStarts;
+		std::vector<size_t> frameSizes;
+		std::vector<size_t> outputStarts;
+		size_t outputSize = 0;
+		size_t position = mInputStart;
+		while(position < mInputEnd)
+		{
+			size_t frameSize = ZSTD_findFrameCompressedSize(&mInput[position], mInputEnd - position);
+			if (ZSTD_isError(frameSize))
+			{
+				break;
+			}
+			unsigned long long contentSize = ZSTD_getFrameContentSize(&mInput[position], frameSize);
+			if (contentSize == ZSTD_CONTENTSIZE_UNKNOWN || contentSize == ZSTD_CONTENTSIZE_ERROR ||
+				outputSize + contentSize > OutputBatchSize)
+			{
+				break;
+			}
+			frameStarts.push_back(position);
+			frameSizes.push_back(frameSize);
+			outputStarts.push_back(outputSize);
+			outputSize += size_t(contentSize);
+			position += frameSize;
+		}
+
+		if (frameStarts.empty())
+		{
+			ZSTD_initDStream(mStream);
+			mStreaming = true;
+			setg(NULL, NULL, NULL);
+			return true;
+		}
+
+		mOutput.resize(std::max(outputSize, size_t(1)));
+		outputStarts.push_back(outputSize);
+		std::vector<size_t> results(frameStarts.size());
+		int frameCount = (int) frameStarts.size();
+		#pragma omp parallel for
+		for(int i=0; i<frameCount; ++i)
+		{
+			results[i] = ZSTD_decompress(&mOutput[outputStarts[i]], outputStarts[i+1] - outputStarts[i], &mInput[frameStarts[i]], frameSizes[i]);
+		}
+		for(int i=0; i<frameCount; ++i)
+		{
+			if (ZSTD_isError(results[i]))
+			{
+				throw std::runtime_error(std::string("corrupt zstd frame: ") + ZSTD_getErrorName(results[i]));
+			}
+			if (results[i] != outputStarts[i+1] - outputStarts[i])
+			{
+				throw std::runtime_error("zstd frame does not have the size stored in its header");
+			}
+		}
+
+		mInputStart = position;
+		setg(&mOutput[0], &mOutput[0], &mOutput[0] + outputSize);
+		return true;
+	}
+	//! Decompresses the next part of a frame that is decompressed as a stream
+	void streamFrame()
+	{
+		mOutput.resize(ZSTD_DStreamOutSize());
+		for(;;)
+		{
+			if (mInputStart == mInputEnd)
+			{
+				fillInput();
+				if (mInputStart == mInputEnd)
+				{
+					throw std::runtime_error("truncated zstd frame");
+				}
+			}
+
+			ZSTD_inBuffer input = {&mInput[0], mInputEnd, mInputStart};
+			ZSTD_outBuffer output = {&mOutput[0], mOutput.size(), 0};
+			size_t result = ZSTD_decompressStream(mStream, &output, &input);
+			if (ZSTD_isError(result))
+			{
+				throw std::runtime_error(std::string("corrupt zstd frame: ") + ZSTD_getErrorName(result));
+			}
+			mInputStart = input.pos;
+			mStreaming = result != 0;
+			if (output.pos > 0 || !mStreaming)
+			{
+				setg(&mOutput[0], &mOutput[0], &mOutput[0] + output.pos);
+				return;
+			}
+		}
+	}
+};
+
+// ------------------------------------------------------------------------------
+// Input stream decompressing a file
+// ------------------------------------------------------------------------------
+class DecompressingStream: public std::istream
+{
+private:
+	boost::scoped_ptr<ZstdFrameBuffer>  mFrames;
+	boost::iostreams::filtering_istream mSource;
+	boost::scoped_ptr<ReadAheadBuffer>  mBuffer;
+public:
+	DecompressingStream(const std::string& filename, CompressionType compression)
+		: std::istream(NULL)
+	{
+		mSource.push(boost::iostreams::newline_filter(boost::iostreams::newline::posix));
+		if (compression == COMPRESSION_GZIP)
+		{
+			mSource.push(boost::iostreams::gzip_decompressor());
+			mSource.push(boost::iostreams::file_source(filename, std::ios::in | std::ios::binary));
+		}
+		else
+		{
+			mFrames.reset(new ZstdFrameBuffer(filename));
+			mSource.push(*mFrames);
+		}
+		mSource.exceptions(std::ios::badbit);
+
+		mBuffer.reset(new ReadAheadBuffer(mSource));
+		rdbuf(mBuffer.get());
+		exceptions(std::ios::badbit);
+	}
+};
+
+// ------------------------------------------------------------------------------
+// Detects the compression of a file from its magic number
+// ------------------------------------------------------------------------------
+bool detectCompression(const std::string& filename, CompressionType& compression)
+{
+	std::ifstream file(filename.c_str(), std::ios::in | std::ios::binary);
+	if (!file.is_open())
+	{
+		return false;
+	}
+
+	unsigned char magic[4] = {0, 0, 0, 0};
+	file.read(reinterpret_cast<char*>(magic), 4);
+
+	compression = COMPRESSION_NONE;
+	if (magic[0] == 0x1f && magic[1] == 0x8b)
+	{
+		compression = COMPRESSION_GZIP;
+	}
+	else if (magic[0] == 0x28 && magic[1] == 0xb5 && magic[2] == 0x2f && magic[3] == 0xfd)
+	{
+		compression = COMPRESSION_ZSTD;
+	}
+	return true;
+}
+
+boost::shared_ptr<std::istream> openInputFile(const std::string& filename)
+{
+	CompressionType compression;
+	if (!detectCompression(filename, compression))
+	{
+		return boost::shared_ptr<std::istream>();
+	}
+
+	if (compression == COMPRESSION_NONE)
+	{
+		boost::shared_ptr<std::ifstream> file(new std::ifstream(filename.c_str()));
+		if (!file->is_open())
+		{
+			return boost::shared_ptr<std::istream>();
+		}
+		return file;
+	}
+
+	return boost::shared_ptr<std::istream>(new DecompressingStream(filename, compression));
+}
@@ -0,0 +1,15 @@
+#ifndef INPUT_STREAM_H
+#define INPUT_STREAM_H
+
+#include <istream>
+#include <string>
+
+#include <boost/shared_ptr.hpp>
+
+//! Opens a text file for reading, returns an empty pointer if the file can not be opened
+//! Gzip and zstd compressed files are detected by their magic number and decompressed on the fly.
+//! Decompression runs on a separate thread and fills one buffer while the caller reads the other.
+//! Zstd files made of several frames, as written by parallel compressors, are decompressed on all cores.
+boost::shared_ptr<std::istream> openInputFile(const std::string& filename);
+
+#endif
@@ -0,0 +1,407 @@
+#include "meshlets.h"
+#include <algorithm>
+#include <stdexcept>
+#include <cstdlib>
+#include <cmath>
+
+//=================================================================================================
+// Faces around each vertex, in compressed rows
+// The faces of all components are numbered one after another.
+//=================================================================================================
+void buildVertexFaces(const Mesh& mesh, std::vector<int>& offsets, std::vector<int>& vertexFaces)
+{
+	size_t vertexCount = mesh.vertices.size();
+	offsets.assign(vertexCount+1, 0);
+	for(ComponentListType::const_iterator ic=mesh.components.begin(); ic!=mesh.components.end(); ++ic)
+	{
+		for(size_t f=0; f<ic->faces.size(); ++f)
+		{
+			for(int k=0; k<3; ++k)
+			{
+				offsets[ic->faces[f].data[k]+1]++;
+			}
+		}
+	}
+	for(size_t i=0; i<vertexCount; ++i)
+	{
+		offsets[i+1] += offsets[i];
+	}
+
+	vertexFaces.resize(offsets[vertexCount]);
+	std::vector<int> fill(offsets.begin(), offsets.end()-1);
+	int face = 0;
+	for(ComponentListType::const_iterator ic=mesh.components.begin(); ic!=mesh.components.end(); ++ic)
+	{
+		for(size_t f=0; f<ic->faces.size(); ++f, ++face)
+		{
+			for(int k=0; k<3; ++k)
+			{
+				vertexFaces[fill[ic->faces[f].data[k]]++] = face;
+			}
+		}
+	}
+}
+
+//=================================================================================================
+// Uniform grid over the face centers of a component, to find the nearest unused face
+//=================================================================================================
+class FaceGrid
+{
+public:
+	FaceGrid(const std::vector<Vector3f>& centers);
+
+	//! Returns the unused face whose center is nearest to the point, used faces are removed from the grid
+	int findNearest(const float* point, const std::vector<char>& used);
+
+private:
+	void searchCell(int x, int y, int z, const float* point, const std::vector<char>& used, int& best, float& bestDistance);
+
+	const std::vector<Vector3f>&   mCenters;
+	float                          mMinimum[3];
+	float                          mCellSize;
+	int                            mSize[3];
+	std::vector<std::vector<int> > mCells;
+};
+
+FaceGrid::FaceGrid(const std::vector<Vector3f>& centers) : mCenters(centers)
+{
+	float maximum[3];
+	for(int k=0; k<3; ++k)
+	{
+		mMinimum[k] = maximum[k] = centers.empty() ? 0.0f : centers[0].data[k];
+	}
+	for(size_t f=1; f<centers.size(); ++f)
+	{
+		for(int k=0; k<3; ++k)
+		{
+			mMinimum[k] = std::min(mMinimum[k], centers[f].data[k]);
+			maximum[k] = std::max(maximum[k], centers[f].data[k]);
+		}
+	}
+
+	// About one face per cell, flat extents do not count as dimension
+	float largestExtent = std::max(maximum[0]-mMinimum[0], std::max(maximum[1]-mMinimum[1], maximum[2]-mMinimum[2]));
+	double volume = 1.0;
+	int dimensions = 0;
+	for(int k=0; k<3; ++k)
+	{
+		float extent = maximum[k]-mMinimum[k];
+		if (extent > 1e-6f*largestExtent)
+		{
+			volume *= extent;
+			dimensions++;
+		}
+	}
+	mCellSize = dimensions > 0 ? (float) pow(volume / std::max<size_t>(centers.size(), 1), 1.0 / dimensions) : 1.0f;
+	mCellSize = std::max(mCellSize, largestExtent / 1024.0f);
+	if (mCellSize <= 0.0f)
+	{
+		mCellSize = 1.0f;
+	}
+	for(int k=0; k<3; ++k)
+	{
+		mSize[k] = (int) ((maximum[k]-mMinimum[k]) / mCellSize) + 1;
+	}
+
+	mCells.resize((size_t) mSize[0]*mSize[1]*mSize[2]);
+	for(size_t f=0; f<centers.size(); ++f)
+	{
+		int cell[3];
+		for(int k=0; k<3; ++k)
+		{
+			cell[k] = std::min(mSize[k]-1, (int) ((centers[f].data[k]-mMinimum[k]) / mCellSize));
+		}
+		mCells[((size_t) cell[2]*mSize[1] + cell[1])*mSize[0] + cell[0]].push_back((int) f);
+	}
+}
+
+void FaceGrid::searchCell(int x, int y, int z, const float* point, const std::vector<char>& used, int& best, float& bestDistance)
+{
+	std::vector<int>& cell = mCells[((size_t) z*mSize[1] + y)*mSize[0] + x];
+	size_t kept = 0;
+	for(size_t i=0; i<cell.size(); ++i)
+	{
+		int face = cell[i];
+		if (used[face])
+		{
+			continue;
+		}
+		cell[kept++] = face;
+		const float* center = mCenters[face].data;
+		float d[3] = {center[0]-point[0], center[1]-point[1], center[2]-point[2]};
+		float distance = d[0]*d[0] + d[1]*d[1] + d[2]*d[2];
+		if (best < 0 || distance < bestDistance)
+		{
+			best = face;
+			bestDistance = distance;
+		}
+	}
+	cell.resize(kept);
+}
+
+int FaceGrid::findNearest(const float* point, const std::vector<char>& used)
+{
+	int center[3];
+	for(int k=0; k<3; ++k)
+	{
+		center[k] = std::max(0, std::min(mSize[k]-1, (int) floor((point[k]-mMinimum[k]) / mCellSize)));
+	}
+
+	// Search rings of cells around the cell of the point, until no nearer face can be in the next ring
+	int best = -1;
+	float bestDistance = 0.0f;
+	int maxRing = std::max(mSize[0], std::max(mSize[1], mSize[2]));
+	for(int ring=0; ring<maxRing; ++ring)
+	{
+		for(int z=std::max(0, center[2]-ring); z<=std::min(mSize[2]-1, center[2]+ring); ++z)
+		{
+			for(int y=std::max(0, center[1]-ring); y<=std::min(mSize[1]-1, center[1]+ring); ++y)
+			{
+				bool inner = abs(z-center[2]) < ring && abs(y-center[1]) < ring;
+				for(int x=std::max(0, center[0]-ring); x<=std::min(mSize[0]-1, center[0]+ring); ++x)
+				{
+					if (inner && abs(x-center[0]) < ring)
+					{
+						x = center[0]+ring-1;
+						continue;
+					}
+					searchCell(x, y, z, point, used, best, bestDistance);
+				}
+			}
+		}
+		if (best >= 0 && bestDistance <= (ring*mCellSize)*(ring*mCellSize))
+		{
+			break;
+		}
+	}
+	return best;
+}
+
+//=================================================================================================
+// Computes the bounding sphere and the normal cone of a meshlet
+//=================================================================================================
+void computeMeshletBounds(const Mesh& mesh, const MeshletList& list, Meshlet& meshlet)
+{
+	const unsigned int* vertices = &list.vertices[meshlet.firstVertex];
+
+	// Sphere around the center of the bounding box
+	float minimum[3], maximum[3];
+	for(int k=0; k<3; ++k)
+	{
+		minimum[k] = maximum[k] = mesh.vertices[vertices[0]].data[k];
+	}
+	for(unsigned int i=1; i<meshlet.vertexCount; ++i)
+	{
+		for(int k=0; k<3; ++k)
+		{
+			minimum[k] = std::min(minimum[k], mesh.vertices[vertices[i]].data[k]);
+			maximum[k] = std::max(maximum[k], mesh.vertices[vertices[i]].data[k]);
+		}
+	}
+	for(int k=0; k<3; ++k)
+	{
+		meshlet.center[k] = 0.5f*(minimum[k] + maximum[k]);
+	}
+	float radiusSquared = 0.0f;
+	for(unsigned int i=0; i<meshlet.vertexCount; ++i)
+	{
+		const float* p = mesh.vertices[vertices[i]].data;
+		float d[3] = {p[0]-meshlet.center[0], p[1]-meshlet.center[1], p[2]-meshlet.center[2]};
+		radiusSquared = std::max(radiusSquared, d[0]*d[0] + d[1]*d[1] + d[2]*d[2]);
+	}
+	meshlet.radius = sqrt(radiusSquared);
+
+	// Cone around the average face normal
+	std::vector<Vector3f> normals;
+	normals.reserve(meshlet.triangleCount);
+	float axis[3] = {0.0f, 0.0f, 0.0f};
+	for(unsigned int t=0; t<meshlet.triangleCount; ++t)
+	{
+		const unsigned char* triangle = &list.triangles[3*(meshlet.firstTriangle + t)];
+		const float* p0 = mesh.vertices[vertices[triangle[0]]].data;
+		const float* p1 = mesh.vertices[vertices[triangle[1]]].data;
+		const float* p2 = mesh.vertices[vertices[triangle[2]]].data;
+		float e1[3] = {p1[0]-p0[0], p1[1]-p0[1], p1[2]-p0[2]};
+		float e2[3] = {p2[0]-p0[0], p2[1]-p0[1], p2[2]-p0[2]};
+		Vector3f normal;
+		normal.data[0] = e1[1]*e2[2]-e1[2]*e2[1];
+		normal.data[1] = e1[2]*e2[0]-e1[0]*e2[2];
+		normal.data[2] = e1[0]*e2[1]-e1[1]*e2[0];
+		float length = sqrt(normal.data[0]*normal.data[0] + normal.data[1]*normal.data[1] + normal.data[2]*normal.data[2]);
+		if (length <= 0.0f)
+		{
+			continue;
+		}
+		for(int k=0; k<3; ++k)
+		{
+			normal.data[k] /= length;
+			axis[k] += normal.data[k];
+		}
+		normals.push_back(normal);
+	}
+
+	float axisLength = sqrt(axis[0]*axis[0] + axis[1]*axis[1] + axis[2]*axis[2]);
+	meshlet.coneCutoff = -1.0f;
+	for(int k=0; k<3; ++k)
+	{
+		meshlet.coneAxis[k] = axisLength > 0.0f ? axis[k] / axisLength : 0.0f;
+	}
+	if (axisLength > 0.0f)
+	{
+		float cutoff = 1.0f;
+		for(size_t i=0; i<normals.size(); ++i)
+		{
+			const float* n = normals[i].data;
+			cutoff = std::min(cutoff, n[0]*meshlet.coneAxis[0] + n[1]*meshlet.coneAxis[1] + n[2]*meshlet.coneAxis[2]);
+		}
+		meshlet.coneCutoff = cutoff > 0.0f ? cutoff : -1.0f;
+	}
+}
+
+//=================================================================================================
+// Splits the faces of each component into meshlets
+//=================================================================================================
+void buildMeshlets(const Mesh& mesh, int maxVertices, int maxTriangles, MeshletList& result)
+{
+	if (maxVertices < 3 || maxVertices > 256 || maxTriangles < 1)
+	{
+		throw std::runtime_error("invalid meshlet limits");
+	}
+
+	result.meshlets.clear();
+	result.vertices.clear();
+	result.triangles.clear();
+
+	std::vector<int> localIndex(mesh.vertices.size(), -1);
+	std::vector<int> offsets;
+	std::vector<int> vertexFaces;
+	std::vector<int> candidates;
+	buildVertexFaces(mesh, offsets, vertexFaces);
+	int firstFace = 0;
+	for(size_t c=0; c<mesh.components.size(); ++c)
+	{
+		const std::vector<Vector3i>& faces = mesh.components[c].faces;
+		int faceCount = (int) faces.size();
+		std::vector<char> used(faces.size(), 0);
+		int unusedCount = faceCount;
+
+		std::vector<Vector3f> centers(faces.size());
+		for(size_t f=0; f<faces.size(); ++f)
+		{
+			for(int k=0; k<3; ++k)
+			{
+				centers[f].data[k] = (mesh.vertices[faces[f].data[0]].data[k] + mesh.vertices[faces[f].data[1]].data[k] + mesh.vertices[faces[f].data[2]].data[k]) / 3.0f;
+			}
+		}
+		FaceGrid grid(centers);
+
+		size_t nextSeed = 0;
+		while(true)
+		{
+			while(nextSeed < faces.size() && used[nextSeed])
+			{
+				nextSeed++;
+			}
+			if (nextSeed == faces.size())
+			{
+				break;
+			}
+
+			Meshlet meshlet;
+			meshlet.component = (unsigned int) c;
+			meshlet.firstVertex = (unsigned int) result.vertices.size();
+			meshlet.vertexCount = 0;
+			meshlet.firstTriangle = (unsigned int) (result.triangles.size() / 3);
+			meshlet.triangleCount = 0;
+			float minimum[3], maximum[3];
+
+			candidates.clear();
+			int face = (int) nextSeed;
+			while(face >= 0)
+			{
+				// Add the face and its new vertices, with their faces in this component as candidates
+				used[face] = 1;
+				unusedCount--;
+				for(int k=0; k<3; ++k)
+				{
+					int vertex = faces[face].data[k];
+					if (localIndex[vertex] < 0)
+					{
+						localIndex[vertex] = (int) meshlet.vertexCount++;
+						result.vertices.push_back((unsigned int) vertex);
+						for(int i=offsets[vertex]; i<offsets[vertex+1]; ++i)
+						{
+							int candidate = vertexFaces[i] - firstFace;
+							if (candidate >= 0 && candidate < faceCount)
+							{
+								candidates.push_back(candidate);
+							}
+						}
+						for(int j=0; j<3; ++j)
+						{
+							float value = mesh.vertices[vertex].data[j];
+							minimum[j] = meshlet.vertexCount == 1 ? value : std::min(minimum[j], value);
+							maximum[j] = meshlet.vertexCount == 1 ? value : std::max(maximum[j], value);
+						}
+					}
+					result.triangles.push_back((unsigned char) localIndex[vertex]);
+				}
+				meshlet.triangleCount++;
+				if ((int) meshlet.triangleCount >= maxTriangles)
+				{
+					break;
+				}
+
+				// Continue with the adjacent face that adds the fewest vertices
+				face = -1;
+				int bestNewVertices = 4;
+				size_t kept = 0;
+				for(size_t i=0; i<candidates.size(); ++i)
+				{
+					int candidate = candidates[i];
+					if (used[candidate])
+					{
+						continue;
+					}
+					candidates[kept++] = candidate;
+					int newVertices = 0;
+					for(int k=0; k<3; ++k)
+					{
+						newVertices += localIndex[faces[candidate].data[k]] < 0 ? 1 : 0;
+					}
+					if (newVertices < bestNewVertices && (int) meshlet.vertexCount + newVertices <= maxVertices)
+					{
+						bestNewVertices = newVertices;
+						face = candidate;
+					}
+				}
+				candidates.resize(kept);
+
+				// Without a fitting neighbor, flat shaded or seam split faces continue with the unused face
+				// nearest to the center of the meshlet, as long as any face fits
+				if (face < 0 && unusedCount > 0 && (int) meshlet.vertexCount + 3 <= maxVertices)
+				{
+					float center[3];
+					for(int k=0; k<3; ++k)
+					{
+						center[k] = 0.5f*(minimum[k] + maximum[k]);
+					}
+					face = grid.findNearest(center, used);
+				}
+			}
+
+			for(unsigned int i=0; i<meshlet.vertexCount; ++i)
+			{
+				localIndex[result.vertices[meshlet.firstVertex + i]] = -1;
+			}
+			result.meshlets.push_back(meshlet);
+		}
+		firstFace += faceCount;
+	}
+
+	#pragma omp parallel for
+	for(int m=0; m<(int) result.meshlets.size(); ++m)
+	{
+		computeMeshletBounds(mesh, result, result.meshlets[m]);
+	}
+}
@@ -0,0 +1,36 @@
+#ifndef MESHLETS_H
+#define MESHLETS_H
+
+#include "objTypes.h"
+
+//! A small cluster of triangles of one component, with bounds for culling
+struct Meshlet
+{
+	unsigned int component;     //!< Index of the mesh component
+	unsigned int firstVertex;   //!< Offset of the first vertex in MeshletList::vertices
+	unsigned int vertexCount;
+	unsigned int firstTriangle; //!< Offset of the first triangle in MeshletList::triangles, in triangles
+	unsigned int triangleCount;
+	float        center[3];     //!< Bounding sphere
+	float        radius;
+	float        coneAxis[3];   //!< Average direction of the triangle normals
+	float        coneCutoff;    //!< Cosine of the largest angle between the axis and a normal, -1 if wider than 90 degrees
+};
+
+//! Meshlets of a mesh
+//! Each meshlet references its vertices through the vertex list, and its triangles as triples of
+//! 8-bit indices into its part of the vertex list.
+struct MeshletList
+{
+	std::vector<Meshlet>       meshlets;
+	std::vector<unsigned int>  vertices;
+	std::vector<unsigned char> triangles;
+};
+
+//! Splits the faces of each component into meshlets of at most maxVertices vertices and maxTriangles triangles
+//! Meshlets are grown greedily over adjacent triangles, preferring triangles that add the fewest vertices.
+//! If no adjacent triangle fits, as in flat shaded or seam split meshes, a meshlet continues with the unused
+//! triangle whose center is nearest to the center of its bounds.
+void buildMeshlets(const Mesh& mesh, int maxVertices, int maxTriangles, MeshletList& result);
+
+#endif
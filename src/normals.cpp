@@ -0,0 +1,221 @@
+#include "normals.h"
+#include <algorithm>
+#include <stdexcept>
+#include <cmath>
+
+//=================================================================================================
+// Normalizes a vector in place, returns its original length
+//=================================================================================================
+float normalize(float* v)
+{
+	float length = sqrt(v[0]*v[0] + v[1]*v[1] + v[2]*v[2]);
+	if (length > 0.0f)
+	{
+		v[0] /= length;
+		v[1] /= length;
+		v[2] /= length;
+	}
+	return length;
+}
+
+//=================================================================================================
+// Computes the unit normal, the area and the corner angles of each face
+//=================================================================================================
+void computeFaceGeometry(const Mesh& mesh, const std::vector<const Vector3i*>& faces, std::vector<Vector3f>& faceNormals, std::vector<float>& faceAreas, std::vector<Vector3f>& cornerAngles)
+{
+	faceNormals.resize(faces.size());
+	faceAreas.resize(faces.size());
+	cornerAngles.resize(faces.size());
+
+	#pragma omp parallel for
+	for(int f=0; f<(int) faces.size(); ++f)
+	{
+		const float* p[3];
+		for(int k=0; k<3; ++k)
+		{
+			p[k] = mesh.vertices[faces[f]->data[k]].data;
+		}
+
+		float edges[3][3];
+		for(int k=0; k<3; ++k)
+		{
+			const float* a = p[k];
+			const float* b = p[(k+1)%3];
+			edges[k][0] = b[0]-a[0];
+			edges[k][1] = b[1]-a[1];
+			edges[k][2] = b[2]-a[2];
+		}
+
+		const float* e1 = edges[0];
+		float e2[3] = {p[2][0]-p[0][0], p[2][1]-p[0][1], p[2][2]-p[0][2]};
+		float* n = faceNormals[f].data;
+		n[0] = e1[1]*e2[2] - e1[2]*e2[1];
+		n[1] = e1[2]*e2[0] - e1[0]*e2[2];
+		n[2] = e1[0]*e2[1] - e1[1]*e2[0];
+		faceAreas[f] = 0.5f * normalize(n);
+
+		// The angle at corner k is between the outgoing edge k and the incoming edge k-1
+		for(int k=0; k<3; ++k)
+		{
+			float outgoing[3] = {edges[k][0], edges[k][1], edges[k][2]};
+			float incoming[3] = {-edges[(k+2)%3][0], -edges[(k+2)%3][1], -edges[(k+2)%3][2]};
+			if (normalize(outgoing) > 0.0f && normalize(incoming) > 0.0f)
+			{
+				float cosine = outgoing[0]*incoming[0] + outgoing[1]*incoming[1] + outgoing[2]*incoming[2];
+				cornerAngles[f].data[k] = acos(std::max(-1.0f, std::min(1.0f, cosine)));
+			}
+			else
+			{
+				cornerAngles[f].data[k] = 0.0f;
+			}
+		}
+	}
+}
+
+//=================================================================================================
+// Generates smoothed vertex normals, splitting vertices with differing corner normals
+//=================================================================================================
+void generateNormals(Mesh& mesh, std::vector<int>& sourceVertices, const std::vector<int>& smoothingGroups, float creaseAngle)
+{
+	std::vector<const Vector3i*> faces;
+	for(ComponentListType::const_iterator ic=mesh.components.begin(); ic!=mesh.components.end(); ++ic)
+	{
+		for(size_t f=0; f<ic->faces.size(); ++f)
+		{
+			faces.push_back(&ic->faces[f]);
+		}
+	}
+	if (smoothingGroups.size() != faces.size() || sourceVertices.size() != mesh.vertices.size())
+	{
+		throw std::runtime_error("inconsistent smoothing groups");
+	}
+
+	std::vector<Vector3f> faceNormals;
+	std::vector<float> faceAreas;
+	std::vector<Vector3f> cornerAngles;
+	computeFaceGeometry(mesh, faces, faceNormals, faceAreas, cornerAngles);
+
+	// Face corners around each source position, in compressed rows
+	int positionCount = 0;
+	for(size_t i=0; i<sourceVertices.size(); ++i)
+	{
+		positionCount = std::max(positionCount, sourceVertices[i] + 1);
+	}
+	std::vector<int> offsets(positionCount+1, 0);
+	for(size_t f=0; f<faces.size(); ++f)
+	{
+		for(int k=0; k<3; ++k)
+		{
+			offsets[sourceVertices[faces[f]->data[k]]+1]++;
+		}
+	}
+	for(int i=0; i<positionCount; ++i)
+	{
+		offsets[i+1] += offsets[i];
+	}
+	std::vector<int> positionCorners(offsets[positionCount]);
+	std::vector<int> fill(offsets.begin(), offsets.end()-1);
+	for(size_t f=0; f<faces.size(); ++f)
+	{
+		for(int k=0; k<3; ++k)
+		{
+			positionCorners[fill[sourceVertices[faces[f]->data[k]]]++] = (int) (3*f + k);
+		}
+	}
+
+	// Normal of each face corner
+	float creaseCosine = cos(creaseAngle * 3.14159265358979323846f / 180.0f);
+	std::vector<Vector3f> cornerNormals(3*faces.size());
+	#pragma omp parallel for
+	for(int f=0; f<(int) faces.size(); ++f)
+	{
+		// Degenerate faces have no normal to compare against, they take the smooth normal
+		const float* faceNormal = faceNormals[f].data;
+		float faceCreaseCosine = faceAreas[f] > 0.0f ? creaseCosine : -2.0f;
+		for(int k=0; k<3; ++k)
+		{
+			float* normal = cornerNormals[3*f+k].data;
+			if (smoothingGroups[f] == 0)
+			{
+				std::copy(faceNormal, faceNormal+3, normal);
+				continue;
+			}
+
+			int position = sourceVertices[faces[f]->data[k]];
+			for(int i=offsets[position]; i<offsets[position+1]; ++i)
+			{
+				int corner = positionCorners[i];
+				int other = corner / 3;
+				const float* otherNormal = faceNormals[other].data;
+				if (other != f && (smoothingGroups[other] != smoothingGroups[f] ||
+					faceNormal[0]*otherNormal[0] + faceNormal[1]*otherNormal[1] + faceNormal[2]*otherNormal[2] < faceCreaseCosine))
+				{
+					continue;
+				}
+				float weight = faceAreas[other] * cornerAngles[other].data[corner % 3];
+				normal[0] += weight * otherNormal[0];
+				normal[1] += weight * otherNormal[1];
+				normal[2] += weight * otherNormal[2];
+			}
+			if (normalize(normal) <= 0.0f)
+			{
+				std::copy(faceNormal, faceNormal+3, normal);
+			}
+		}
+	}
+
+	// Assign the corner normals to the vertices, vertices with different normals are copied
+	size_t vertexCount = mesh.vertices.size();
+	bool hasTexCoord = mesh.texcoord.size() == vertexCount;
+	mesh.normals.resize(vertexCount);
+	std::vector<char> assigned(vertexCount, 0);
+	std::vector<int> nextCopy(vertexCount, -1);
+	size_t faceIndex = 0;
+	for(ComponentListType::iterator ic=mesh.components.begin(); ic!=mesh.components.end(); ++ic)
+	{
+		for(size_t f=0; f<ic->faces.size(); ++f, ++faceIndex)
+		{
+			for(int k=0; k<3; ++k)
+			{
+				const Vector3f& normal = cornerNormals[3*faceIndex+k];
+				int vertex = ic->faces[f].data[k];
+				if (!assigned[vertex])
+				{
+					mesh.normals[vertex] = normal;
+					assigned[vertex] = 1;
+					continue;
+				}
+
+				// Find a copy with the same normal
+				int copy = vertex;
+				int last = vertex;
+				while(copy >= 0)
+				{
+					const float* n = mesh.normals[copy].data;
+					if (n[0]*normal.data[0] + n[1]*normal.data[1] + n[2]*normal.data[2] > 0.99999f)
+					{
+						break;
+					}
+					last = copy;
+					copy = nextCopy[copy];
+				}
+				if (copy < 0)
+				{
+					copy = (int) mesh.vertices.size();
+					Vector3f position = mesh.vertices[vertex];
+					mesh.vertices.push_back(position);
+					mesh.normals.push_back(normal);
+					if (hasTexCoord)
+					{
+						Vector2f texcoord = mesh.texcoord[vertex];
+						mesh.texcoord.push_back(texcoord);
+					}
+					sourceVertices.push_back(sourceVertices[vertex]);
+					nextCopy.push_back(-1);
+					nextCopy[last] = copy;
+				}
+				ic->faces[f].data[k] = copy;
+			}
+		}
+	}
+}
@@ -0,0 +1,17 @@
+#ifndef NORMALS_H
+#define NORMALS_H
+
+#include "objTypes.h"
+
+//! Normalizes a vector in place, returns its original length
+float normalize(float* v);
+
+//! Generates vertex normals for a mesh without normals
+//! Each face corner gets the angle and area weighted average of the normals of the faces around its
+//! position that are in the same smoothing group and within the crease angle. Smoothing group 0 means
+//! flat shading. Vertices with different corner normals are split.
+//! \param sourceVertices Index of the obj position of each mesh vertex, vertices of one position are smoothed together
+//! \param smoothingGroups Smoothing group of each face, for the faces of all components one after another
+void generateNormals(Mesh& mesh, std::vector<int>& sourceVertices, const std::vector<int>& smoothingGroups, float creaseAngle);
+
+#endif
@@ -77,13 +77,17 @@ struct Material
 
 struct MeshComponent
 {
-	std::string           materialName;
+	int                   materialId;   //!< Index into Mesh::materialNames, 0 for no material
 	std::string           componentName;
 	std::vector<Vector3i> faces;
+	MeshComponent()
+	{
+		materialId = 0;
+	}
 	void reset()
 	{
 		componentName = "default";
-		materialName = "";
+		materialId = 0;
 		faces.clear();
 	}
 };
@@ -98,10 +102,16 @@ struct Mesh
 	std::vector<Vector3f>      normals;
 	std::vector<Vector2f>      texcoord;
 	MaterialMapType            materials;
+	std::vector<std::string>   materialNames; //!< Name of each material id, id 0 is the empty name of components without a material
+	Mesh()
+	{
+		materialNames.resize(1);
+	}
 	void reset()
 	{
 		components.clear();
 		vertices.clear();
+		materialNames.assign(1, std::string());
 	}
 };
 
@@ -1,17 +1,43 @@
 #include "packer.h"
+#include "resampler.h"
+#include "resolver.h"
+#include "pngEncoder.h"
 
 #include <set>
 #include <list>
 #include <map>
 #include <algorithm>
+#include <functional>
+#include <sstream>
 #include <fstream>
+#include <iostream>
+#include <cmath>
+#include <cctype>
+#include <limits>
 
 #include "IL/il.h"
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define BAKEOBJ_SSE2
+#include <emmintrin.h>
+#endif
+
 #include <boost/shared_ptr.hpp>
 #include <boost/weak_ptr.hpp>
 
 
+//! Number of pixels kept around the used part of a texture when cropping
+const int cropGutter = 4;
+
+//! Maximum area of a repeated texture in the atlas, relative to the texture area
+const double repeatBudget = 4.0;
+
+//! Texels with an alpha this close to 0 or 255 count as transparent or opaque when classifying textures
+const int alphaTestTolerance = 8;
+
+//! Largest share of partially transparent texels in an alpha tested texture, such as the antialiased edges of cutouts
+const double alphaTestGradedFraction = 0.02;
+
 class TextureTile;
 class TextureTileQuad;
 class TextureTileLeaf;
@@ -43,7 +69,10 @@ public:
 public:
 	void getTileOffset(TextureTilePtr tile, int& resultX, int& resultY) const;
 	TextureTileQuadPtr addQuad(const TextureTileArrayType& children);
-	TextureTileLeafPtr addLeaf(const std::string& filename);
+	void addLeaf(TextureTileLeafPtr leaf);
+	static TextureTileLeafPtr loadLeaf(const std::string& filename);
+	static TextureTileLeafPtr loadLeaf(const std::string& filename, const std::string& data);
+	static TextureTileLeafPtr maskLeaf(const TextureTileLeaf& diffuse, const TextureTileLeaf& opacity);
 };
 
 // ------------------------------------------------------------------------------
@@ -123,17 +152,37 @@ int TextureTileQuad::offsetsY[4] = {0,0,1,1};
 class TextureTileLeaf: public TextureTile
 {
 public:
+	std::string mFilename;
+	std::string mOpacityFilename;
 	int mExactWidth;
 	int mExactHeight;
+	int mCropX;
+	int mCropY;
+	int mCropWidth;
+	int mCropHeight;
+	int mScaledWidth;
+	int mScaledHeight;
 	int mSizeX;
 	int mSizeY;
 	ILuint mImage;
 public:
 	virtual int getSizeX() const { return mSizeX; }
 	virtual int getSizeY() const { return mSizeY; }
+	const std::string& getFilename() const { return mFilename; }
+	const std::string& getOpacityFilename() const { return mOpacityFilename; }
 	int getExactWidth() const { return mExactWidth; }
 	int getExactHeight() const { return mExactHeight; }
+	int getCropX() const { return mCropX; }
+	int getCropY() const { return mCropY; }
+	int getCropWidth() const { return mCropWidth; }
+	int getCropHeight() const { return mCropHeight; }
+	int getScaledWidth() const { return mScaledWidth; }
+	int getScaledHeight() const { return mScaledHeight; }
+	bool isScaled() const { return mScaledWidth != mCropWidth || mScaledHeight != mCropHeight; }
 	ILuint getImage() const { return mImage; }
+	void setCrop(int x, int y, int width, int height);
+	void setScale(double scale);
+	void setScaledSize(int width, int height);
 public:
 	virtual bool getTileOffset(TextureTilePtr tile, int offsetX, int offsetY, int& resultX, int& resultY) const
 	{
@@ -147,11 +196,19 @@ public:
 	}
 private:
 	void loadFromFile(const std::string& filename);
+	void loadFromMemory(const std::string& filename, const std::string& data);
+	void convertLoadedImage();
 	friend class TextureTileTree;
 	TextureTileLeaf()
 	{
 		mExactWidth = 0;
 		mExactHeight = 0;
+		mCropX = 0;
+		mCropY = 0;
+		mCropWidth = 0;
+		mCropHeight = 0;
+		mScaledWidth = 0;
+		mScaledHeight = 0;
 		mImage = 0;
 		ilGenImages(1, &mImage);
 	}
@@ -191,13 +248,23 @@ TextureTileQuadPtr TextureTileTree::addQuad(const TextureTileArrayType& children
 	return quad;
 }
 
-TextureTileLeafPtr TextureTileTree::addLeaf(const std::string& filename)
+void TextureTileTree::addLeaf(TextureTileLeafPtr leaf)
 {
-	TextureTileLeafPtr leaf(new TextureTileLeaf);
 	mHeads.push_back(leaf);
+	mHeads.sort(compareTiles);
+}
+
+TextureTileLeafPtr TextureTileTree::loadLeaf(const std::string& filename)
+{
+	TextureTileLeafPtr leaf(new TextureTileLeaf);
 	leaf->loadFromFile(filename);
+	return leaf;
+}
 
-	mHeads.sort(compareTiles);
+TextureTileLeafPtr TextureTileTree::loadLeaf(const std::string& filename, const std::string& data)
+{
+	TextureTileLeafPtr leaf(new TextureTileLeaf);
+	leaf->loadFromMemory(filename, data);
 	return leaf;
 }
 
@@ -225,6 +292,7 @@ int getNextPoT(int i)
 
 void TextureTileLeaf::loadFromFile(const std::string& filename)
 {
+	mFilename = filename;
 	ilBindImage(mImage);
 	std::wstring wFilename(filename.length()+1, 0);
 	std::copy(filename.begin(), filename.end(), wFilename.begin());
@@ -233,152 +301,1559 @@ void TextureTileLeaf::loadFromFile(const std::string& filename)
 	{
 		throw std::runtime_error("could not load texture file " + filename);
 	}
+	convertLoadedImage();
+}
+
+// ------------------------------------------------------------------------------
+// Decodes a texture file that was read into memory, the format is detected from its contents
+// ------------------------------------------------------------------------------
+void TextureTileLeaf::loadFromMemory(const std::string& filename, const std::string& data)
+{
+	mFilename = filename;
+	ilBindImage(mImage);
+	if(data.empty() || ilLoadL(IL_TYPE_UNKNOWN, data.data(), ILuint(data.size())) != IL_TRUE)
+	{
+		throw std::runtime_error("could not load texture file " + filename);
+	}
+	convertLoadedImage();
+}
 
+void TextureTileLeaf::convertLoadedImage()
+{
 	if(ilConvertImage(IL_RGBA, IL_UNSIGNED_BYTE) != IL_TRUE)
 	{
-		throw std::runtime_error("could not convert texture to 32bit RGBA " + filename);
+		throw std::runtime_error("could not convert texture to 32bit RGBA " + mFilename);
 	}
 
 	mExactWidth = ilGetInteger(IL_IMAGE_WIDTH);
 	mExactHeight = ilGetInteger(IL_IMAGE_HEIGHT);
-	mSizeX = getNextPoT(mExactWidth);
-	mSizeY = getNextPoT(mExactHeight);
+	setCrop(0, 0, mExactWidth, mExactHeight);
 }
 
+// ------------------------------------------------------------------------------
+// Restricts the tile to a rectangle of the texture, in pixels with rows counted from the top
+// ------------------------------------------------------------------------------
+void TextureTileLeaf::setCrop(int x, int y, int width, int height)
+{
+	mCropX = x;
+	mCropY = y;
+	mCropWidth = width;
+	mCropHeight = height;
+	setScale(1.0);
+}
 
-void transformTexcoord(Vector2f& out, const Vector2f& in, float ax, float bx, float ay, float by)
+// ------------------------------------------------------------------------------
+// Scales the cropped texture down, a scale of 1 keeps the original resolution
+// ------------------------------------------------------------------------------
+void TextureTileLeaf::setScale(double scale)
 {
-	out.data[0] = ax*in.data[0] + bx;
-	out.data[1] = ay*in.data[1] + by;
+	setScaledSize(std::max(1, std::min(mCropWidth, (int) floor(mCropWidth*scale + 0.5))),
+		std::max(1, std::min(mCropHeight, (int) floor(mCropHeight*scale + 0.5))));
 }
 
-void packTextures(const Mesh& inputMesh, Mesh& outputMesh, const std::string& textureFilename)
+void TextureTileLeaf::setScaledSize(int width, int height)
 {
-	ilInit();
+	mScaledWidth = width;
+	mScaledHeight = height;
+	mSizeX = getNextPoT(mScaledWidth);
+	mSizeY = getNextPoT(mScaledHeight);
+}
 
-	// Collect all actually used materials
-	std::set<std::string> usedMaterialNames;
-	for(ComponentListType::const_iterator ic=inputMesh.components.begin();ic!=inputMesh.components.end();++ic)
+// ------------------------------------------------------------------------------
+// Crops a tile to the pixels covered by the given texture coordinate range plus a gutter
+// Ranges outside [0,1] repeat the texture, as long as the repeated area stays within the budget.
+// ------------------------------------------------------------------------------
+void cropToBounds(TextureTileLeaf& leaf, const TexcoordBounds& bounds)
+{
+	int width = leaf.getExactWidth();
+	int height = leaf.getExactHeight();
+	if (bounds.isEmpty())
 	{
-		usedMaterialNames.insert(ic->materialName);
+		leaf.setCrop(0, 0, width, height);
+		return;
 	}
 
-	// Create a tree of all tiles
-	TextureTileTree tileTree;
+	// Texture coordinates count rows from the bottom, the image counts them from the top
+	int x0 = (int) floor(bounds.min[0]*width) - cropGutter;
+	int x1 = (int) ceil(bounds.max[0]*width) + cropGutter;
+	int y0 = (int) floor((1.0f-bounds.max[1])*height) - cropGutter;
+	int y1 = (int) ceil((1.0f-bounds.min[1])*height) + cropGutter;
 
-	// Create one leaf for each input material texture
-	typedef std::map<std::string, TextureTileLeafPtr> MaterialTileMapType;
-	MaterialTileMapType materialTiles;
-	for(MaterialMapType::const_iterator im=inputMesh.materials.begin();im!=inputMesh.materials.end();++im)
+	bool isRepeated = bounds.min[0] < 0.0f || bounds.min[1] < 0.0f || bounds.max[0] > 1.0f || bounds.max[1] > 1.0f;
+	if (isRepeated && double(x1-x0)*double(y1-y0) > repeatBudget*double(width)*double(height))
 	{
-		const std::string name = im->first;
-		const Material& mat = im->second;
-		if (!mat.textureDiffuse.empty() && usedMaterialNames.find(name)!=usedMaterialNames.end())
-		{
-			TextureTileLeafPtr leaf = tileTree.addLeaf(mat.textureDiffuse);
-			materialTiles[name] = leaf;
-		}
+		std::cerr << "texture " << leaf.getFilename() << " is repeated more often than the budget allows, "
+			<< "texture coordinates outside [0,1] will sample neighbouring tiles" << std::endl;
+		isRepeated = false;
 	}
 
-	// Combine tiles until only one image remains
-	TextureTileArrayType candidateTiles;
-	candidateTiles.reserve(8);
-	while(tileTree.size()>1)
+	if (!isRepeated)
 	{
-		// Find candidates to combine
-		TextureTilePtr smallestTile = tileTree.getSmallestTile();
+		x0 = std::max(0, std::min(x0, width-1));
+		y0 = std::max(0, std::min(y0, height-1));
+		x1 = std::max(x0+1, std::min(x1, width));
+		y1 = std::max(y0+1, std::min(y1, height));
+	}
+	leaf.setCrop(x0, y0, x1-x0, y1-y0);
+}
 
-		candidateTiles.clear();
-		for(TextureTileTree::iterator it=tileTree.begin(); it!=tileTree.end(); ++it)
+// ------------------------------------------------------------------------------
+// Integer division rounding towards negative infinity
+// ------------------------------------------------------------------------------
+inline int floorDiv(int a, int b)
+{
+	return a >= 0 ? a/b : -((-a+b-1)/b);
+}
+
+// ------------------------------------------------------------------------------
+// Creates the bound image as 32bit RGBA with rows counted from the top, like the decoded textures
+// DevIL creates images with their origin at the lower left, pixel copies would return them upside down.
+// ------------------------------------------------------------------------------
+bool createImage(int width, int height, const unsigned char* pixels)
+{
+	if(!ilTexImage(ILuint(width), ILuint(height), 1, 4, IL_RGBA, IL_UNSIGNED_BYTE, const_cast<unsigned char*>(pixels)))
+	{
+		return false;
+	}
+	ilRegisterOrigin(IL_ORIGIN_UPPER_LEFT);
+	return true;
+}
+
+// ------------------------------------------------------------------------------
+// Creates a copy of a diffuse texture whose alpha is taken from an opacity map (map_d)
+// Opacity maps with transparent texels give their alpha, the others their luminance.
+// The map is resampled to the size of the diffuse texture.
+// ------------------------------------------------------------------------------
+TextureTileLeafPtr TextureTileTree::maskLeaf(const TextureTileLeaf& diffuse, const TextureTileLeaf& opacity)
+{
+	int width = diffuse.getExactWidth();
+	int height = diffuse.getExactHeight();
+	std::vector<unsigned char> pixels(4*size_t(width)*size_t(height));
+	ilBindImage(diffuse.getImage());
+	ilCopyPixels(0, 0, 0, width, height, 1, IL_RGBA, IL_UNSIGNED_BYTE, &pixels[0]);
+
+	int opacityWidth = opacity.getExactWidth();
+	int opacityHeight = opacity.getExactHeight();
+	std::vector<unsigned char> mask(4*size_t(opacityWidth)*size_t(opacityHeight));
+	ilBindImage(opacity.getImage());
+	ilCopyPixels(0, 0, 0, opacityWidth, opacityHeight, 1, IL_RGBA, IL_UNSIGNED_BYTE, &mask[0]);
+	if (opacityWidth != width || opacityHeight != height)
+	{
+		std::vector<unsigned char> scaled(pixels.size());
+		resampleImage(&mask[0], opacityWidth, opacityHeight, &scaled[0], width, height);
+		mask.swap(scaled);
+	}
+
+	bool hasAlpha = false;
+	for(size_t i=3; i<mask.size() && !hasAlpha; i+=4)
+	{
+		hasAlpha = mask[i] < 255;
+	}
+	for(size_t i=0; i<pixels.size(); i+=4)
+	{
+		pixels[i+3] = hasAlpha ? mask[i+3] : (unsigned char) ((299*mask[i] + 587*mask[i+1] + 114*mask[i+2] + 500) / 1000);
+	}
+
+	TextureTileLeafPtr leaf(new TextureTileLeaf);
+	leaf->mFilename = diffuse.getFilename();
+	leaf->mOpacityFilename = opacity.getFilename();
+	ilBindImage(leaf->mImage);
+	if (!createImage(width, height, &pixels[0]))
+	{
+		throw std::runtime_error("could not apply the opacity map " + opacity.getFilename() + " to " + diffuse.getFilename());
+	}
+	leaf->mExactWidth = width;
+	leaf->mExactHeight = height;
+	leaf->setCrop(0, 0, width, height);
+	return leaf;
+}
+
+// ------------------------------------------------------------------------------
+// Blits a rectangle of an image into the bound image, clipped to the bound image
+// ------------------------------------------------------------------------------
+bool blitClipped(ILuint sourceImage, int destX, int destY, int sourceX, int sourceY, int width, int height)
+{
+	if (destX < 0)
+	{
+		sourceX -= destX;
+		width += destX;
+		destX = 0;
+	}
+	if (destY < 0)
+	{
+		sourceY -= destY;
+		height += destY;
+		destY = 0;
+	}
+	width = std::min(width, ilGetInteger(IL_IMAGE_WIDTH) - destX);
+	height = std::min(height, ilGetInteger(IL_IMAGE_HEIGHT) - destY);
+	if (width <= 0 || height <= 0)
+	{
+		return true;
+	}
+	return ilBlit(sourceImage, destX, destY, 0, sourceX, sourceY, 0, width, height, 1) == IL_TRUE;
+}
+
+// ------------------------------------------------------------------------------
+// Blits the crop rectangle of a tile into the bound image
+// Parts of the rectangle outside of the texture are filled with repeated copies.
+// ------------------------------------------------------------------------------
+void blitTile(const TextureTileLeaf& leaf, int destX, int destY)
+{
+	int width = leaf.getExactWidth();
+	int height = leaf.getExactHeight();
+	int x0 = leaf.getCropX();
+	int y0 = leaf.getCropY();
+	int x1 = x0 + leaf.getCropWidth();
+	int y1 = y0 + leaf.getCropHeight();
+
+	for(int j=floorDiv(y0, height); j*height<y1; ++j)
+	{
+		for(int i=floorDiv(x0, width); i*width<x1; ++i)
 		{
-			TextureTilePtr candidate = *it;
-			if (smallestTile->getMaxSize() == candidate->getMaxSize())
+			int rx0 = std::max(x0, i*width);
+			int ry0 = std::max(y0, j*height);
+			int rx1 = std::min(x1, (i+1)*width);
+			int ry1 = std::min(y1, (j+1)*height);
+			if(!blitClipped(leaf.getImage(), destX+rx0-x0, destY+ry0-y0, rx0-i*width, ry0-j*height, rx1-rx0, ry1-ry0))
 			{
-				candidateTiles.push_back(candidate);
+				throw std::runtime_error("could not blit into the output image");
 			}
 		}
+	}
+}
 
-		// Create a new tile
-		tileTree.addQuad(candidateTiles);
+
+// ------------------------------------------------------------------------------
+// Creates an image of the crop rectangle of a scaled tile, the caller deletes the image
+// ------------------------------------------------------------------------------
+ILuint createScaledImage(const TextureTileLeaf& leaf)
+{
+	int cropWidth = leaf.getCropWidth();
+	int cropHeight = leaf.getCropHeight();
+	int scaledWidth = leaf.getScaledWidth();
+	int scaledHeight = leaf.getScaledHeight();
+
+	ILuint images[2];
+	ilGenImages(2, images);
+
+	// Copy the crop rectangle including repeats
+	ilBindImage(images[0]);
+	if(!createImage(cropWidth, cropHeight, NULL))
+	{
+		ilDeleteImages(2, images);
+		throw std::runtime_error("could not create a temporary image");
 	}
+	blitTile(leaf, 0, 0);
+	std::vector<unsigned char> cropped(4*size_t(cropWidth)*size_t(cropHeight));
+	ilCopyPixels(0, 0, 0, cropWidth, cropHeight, 1, IL_RGBA, IL_UNSIGNED_BYTE, &cropped[0]);
 
-	int totalSizeX = tileTree.front()->getSizeX();
-	int totalSizeY = tileTree.front()->getSizeY();
+	// Resample into a second image
+	std::vector<unsigned char> scaled(4*size_t(scaledWidth)*size_t(scaledHeight));
+	resampleImage(&cropped[0], cropWidth, cropHeight, &scaled[0], scaledWidth, scaledHeight);
 
-	// Copy data
-	outputMesh.vertices = inputMesh.vertices;
-	outputMesh.normals = inputMesh.normals;
-	outputMesh.texcoord = inputMesh.texcoord;
-	outputMesh.components.push_back(MeshComponent());
-	MeshComponent& outputComponent = outputMesh.components.front();
-	outputComponent.componentName = "default";
-	outputComponent.materialName = "default";
-
-	// Transform texture coordinates
-	for(ComponentListType::const_iterator ic=inputMesh.components.begin();ic!=inputMesh.components.end();++ic)
-	{
-		std::string material = ic->materialName;
-		size_t startFace = outputComponent.faces.size();
-		outputComponent.faces.reserve(outputComponent.faces.size() + ic->faces.size());
-		outputComponent.faces.insert(outputComponent.faces.end(), ic->faces.begin(), ic->faces.end());
-
-		MaterialTileMapType::iterator it = materialTiles.find(material);
-		if (it!=materialTiles.end())
-		{
-			const TextureTileLeafPtr& leaf = it->second;
-			int tileSizeX = leaf->getSizeX();
-			int tileSizeY = leaf->getSizeY();
-			int offsetX, offsetY;
-			tileTree.getTileOffset(leaf, offsetX, offsetY);
-			float bx = offsetX / float(totalSizeX);
-			float by = offsetY / float(totalSizeY);
-			float ax = tileSizeX / float(totalSizeX);
-			float ay = tileSizeY / float(totalSizeY);
-			for(size_t f=0;f<ic->faces.size();++f)
-			{
-				Vector3i indices = ic->faces[f];
-				for(int i=0; i<3; ++i)
-				{
-					transformTexcoord(outputMesh.texcoord[indices.data[i]], inputMesh.texcoord[indices.data[i]], ax,bx,ay,by);
-				}
-			}
+	ilBindImage(images[1]);
+	if(!createImage(scaledWidth, scaledHeight, NULL))
+	{
+		ilDeleteImages(2, images);
+		throw std::runtime_error("could not create a temporary image");
+	}
+	ilSetPixels(0, 0, 0, scaledWidth, scaledHeight, 1, IL_RGBA, IL_UNSIGNED_BYTE, &scaled[0]);
+	ilDeleteImages(1, &images[0]);
+	return images[1];
+}
+
+// ------------------------------------------------------------------------------
+// Blits the crop rectangle of a scaled tile into the given image
+// ------------------------------------------------------------------------------
+void blitScaledTile(const TextureTileLeaf& leaf, ILuint targetImage, int destX, int destY)
+{
+	ILuint scaledImage = createScaledImage(leaf);
+	ilBindImage(targetImage);
+	bool success = blitClipped(scaledImage, destX, destY, 0, 0, leaf.getScaledWidth(), leaf.getScaledHeight());
+	ilDeleteImages(1, &scaledImage);
+	if(!success)
+	{
+		throw std::runtime_error("could not blit into the output image");
+	}
+}
+
+// ------------------------------------------------------------------------------
+// Blits a packed tile into the atlas, the offset counts rows from the bottom like texture coordinates
+// ------------------------------------------------------------------------------
+void blitPackedTile(const TextureTileLeaf& leaf, ILuint atlasImage, int offsetX, int offsetY, int totalSizeY)
+{
+	int destY = totalSizeY-(offsetY+leaf.getSizeY());
+	if (leaf.isScaled())
+	{
+		blitScaledTile(leaf, atlasImage, offsetX, destY);
+	}
+	else
+	{
+		ilBindImage(atlasImage);
+		blitTile(leaf, offsetX, destY);
+	}
+}
+
+// ------------------------------------------------------------------------------
+// Classifies the alpha channel of a rectangle of an image
+// ------------------------------------------------------------------------------
+AlphaMode classifyAlpha(ILuint image, int x, int y, int width, int height)
+{
+	size_t texelCount = size_t(width)*size_t(height);
+	std::vector<unsigned char> pixels(4*texelCount);
+	ilBindImage(image);
+	ilCopyPixels(x, y, 0, width, height, 1, IL_RGBA, IL_UNSIGNED_BYTE, &pixels[0]);
+
+	size_t transparentCount = 0;
+	size_t gradedCount = 0;
+	for(size_t i=0; i<texelCount; ++i)
+	{
+		int alpha = pixels[4*i+3];
+		if (alpha <= alphaTestTolerance)
+		{
+			++transparentCount;
+		}
+		else if (alpha < 255-alphaTestTolerance)
+		{
+			++gradedCount;
 		}
 	}
 
-	// Create the texture atlas
-	ILuint atlasImage;
-	ilGenImages(1, &atlasImage);
-	ilBindImage(atlasImage);
-	if(!ilTexImage(ILuint(totalSizeX), ILuint(totalSizeY), 1, 4, IL_RGBA, IL_UNSIGNED_BYTE, NULL))
+	if (transparentCount == 0 && gradedCount == 0)
 	{
-		throw std::runtime_error("could not create the output image");
+		return alphaOpaque;
 	}
+	return gradedCount > alphaTestGradedFraction*texelCount ? alphaBlended : alphaTested;
+}
 
-	ilDisable(IL_BLIT_BLEND);
+// ------------------------------------------------------------------------------
+// Classifies the alpha channel of the cropped part of a texture, repeated crops look at the whole texture
+// ------------------------------------------------------------------------------
+AlphaMode classifyAlpha(const TextureTileLeaf& leaf)
+{
+	int width = leaf.getExactWidth();
+	int height = leaf.getExactHeight();
+	int x0 = leaf.getCropX();
+	int y0 = leaf.getCropY();
+	int x1 = x0 + leaf.getCropWidth();
+	int y1 = y0 + leaf.getCropHeight();
+	if (x0 < 0 || y0 < 0 || x1 > width || y1 > height)
+	{
+		return classifyAlpha(leaf.getImage(), 0, 0, width, height);
+	}
+	return classifyAlpha(leaf.getImage(), x0, y0, x1-x0, y1-y0);
+}
 
-	// Stitch the texture atlas
-	for(MaterialTileMapType::const_iterator im=materialTiles.begin();im!=materialTiles.end();++im)
+// ------------------------------------------------------------------------------
+// Encodes an image as png with the parallel encoder, the image must count its rows from the top
+// ------------------------------------------------------------------------------
+void encodeImage(ILuint image, const PngOptions& options, std::string& data)
+{
+	ilBindImage(image);
+	int width = ilGetInteger(IL_IMAGE_WIDTH);
+	int height = ilGetInteger(IL_IMAGE_HEIGHT);
+	std::vector<unsigned char> pixels(4*size_t(width)*size_t(height));
+	ilCopyPixels(0, 0, 0, width, height, 1, IL_RGBA, IL_UNSIGNED_BYTE, &pixels[0]);
+	encodePng(&pixels[0], width, height, options, data);
+}
+
+// ------------------------------------------------------------------------------
+// Saves an atlas image, png files are written with the parallel encoder and other formats by DevIL
+// ------------------------------------------------------------------------------
+bool saveAtlasImage(ILuint image, const std::string& filename, const PngOptions& options)
+{
+	std::string extension = filename.size() >= 4 ? filename.substr(filename.size()-4) : std::string();
+	std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+	if (extension == ".png")
 	{
-		const std::string name = im->first;
-		const TextureTileLeafPtr& leaf = im->second;
-		int tileSizeX = leaf->getSizeX();
-		int tileSizeY = leaf->getSizeY();
-		int offsetX, offsetY;
-		tileTree.getTileOffset(leaf, offsetX, offsetY);
+		std::string data;
+		encodeImage(image, options, data);
+		std::ofstream outfile(filename.c_str(), std::ios::out | std::ios::binary);
+		outfile.write(data.data(), data.size());
+		return !outfile.fail();
+	}
 
-		if(!ilBlit(leaf->getImage(), offsetX, totalSizeY-(offsetY+tileSizeY), 0, 0, 0, 0, leaf->getExactWidth(), leaf->getExactHeight(), 1))
+	std::wstring wFilename;
+	wFilename.resize(filename.size()+1,0);
+	std::copy(filename.begin(), filename.end(), wFilename.begin());
+
+	ilBindImage(image);
+	return ilSaveImage(wFilename.c_str()) == IL_TRUE;
+}
+
+// ------------------------------------------------------------------------------
+// Size of the quad-tree that AtlasBuilder::pack builds from tiles of the given sizes
+// ------------------------------------------------------------------------------
+int simulatePackedSize(const std::vector<int>& tileSizes)
+{
+	std::multiset<int> heads(tileSizes.begin(), tileSizes.end());
+	while(heads.size() > 1)
+	{
+		int size = *heads.begin();
+		size_t count = std::min<size_t>(4, heads.count(size));
+		for(size_t i=0; i<count; ++i)
 		{
-			throw std::runtime_error("could not blit into the output image");
+			heads.erase(heads.begin());
 		}
+		heads.insert(2*size);
 	}
+	return heads.empty() ? 0 : *heads.begin();
+}
 
-	std::wstring wFilename;
-	wFilename.resize(textureFilename.size()+1,0);
-	std::copy(textureFilename.begin(), textureFilename.end(), wFilename.begin());
+// ------------------------------------------------------------------------------
+// Scales the tiles to a common texel density, the highest one that fits the atlas into maxSize
+// The density of a tile is the number of its texels per unit of surface area, along one axis.
+// Tiles without area information are scaled like the densest tile.
+// ------------------------------------------------------------------------------
+void fitToBudget(const std::vector<TextureTileLeafPtr>& leaves, const std::vector<MaterialUsage>& usages, int maxSize)
+{
+	std::vector<double> densities(leaves.size(), 0.0);
+	double maxDensity = 0.0;
+	for(size_t i=0; i<leaves.size(); ++i)
+	{
+		const MaterialUsage& usage = usages[i];
+		if (usage.surfaceArea > 0.0 && usage.texcoordArea > 0.0)
+		{
+			double texels = usage.texcoordArea * leaves[i]->getExactWidth() * leaves[i]->getExactHeight();
+			densities[i] = sqrt(texels / usage.surfaceArea);
+			maxDensity = std::max(maxDensity, densities[i]);
+		}
+	}
+	if (maxDensity <= 0.0)
+	{
+		maxDensity = 1.0;
+	}
+	for(size_t i=0; i<leaves.size(); ++i)
+	{
+		if (densities[i] <= 0.0)
+		{
+			densities[i] = maxDensity;
+		}
+	}
 
-	ilSaveImage(wFilename.c_str());
-	ilDeleteImages(1, &atlasImage);
+	// Binary search for the highest density that fits
+	std::vector<int> tileSizes(leaves.size());
+	double low = 0.0;
+	double high = maxDensity;
+	for(int iteration=0; iteration<=40; ++iteration)
+	{
+		double density = iteration==0 ? high : 0.5*(low+high);
+		for(size_t i=0; i<leaves.size(); ++i)
+		{
+			leaves[i]->setScale(std::min(1.0, density/densities[i]));
+			tileSizes[i] = leaves[i]->getMaxSize();
+		}
+		bool fits = simulatePackedSize(tileSizes) <= maxSize;
+		if (iteration==0 && fits)
+		{
+			return;
+		}
+		if (fits)
+		{
+			low = density;
+		}
+		else
+		{
+			high = density;
+		}
+	}
+
+	for(size_t i=0; i<leaves.size(); ++i)
+	{
+		leaves[i]->setScale(std::min(1.0, low/densities[i]));
+		tileSizes[i] = leaves[i]->getMaxSize();
+	}
+	if (simulatePackedSize(tileSizes) > maxSize)
+	{
+		std::cerr << "the atlas does not fit into " << maxSize << " pixels, even with all textures scaled down" << std::endl;
+	}
+}
+
+void transformTexcoord(Vector2f& out, const Vector2f& in, float ax, float bx, float ay, float by)
+{
+	out.data[0] = ax*in.data[0] + bx;
+	out.data[1] = ay*in.data[1] + by;
+}
+
+void transformTexcoord(Vector2f& out, const Vector2f& in, const TileTransform& transform)
+{
+	transformTexcoord(out, in, transform.ax, transform.bx, transform.ay, transform.by);
+}
+
+// ------------------------------------------------------------------------------
+// Appends a copy of a vertex and returns its index
+// ------------------------------------------------------------------------------
+int copyVertex(Mesh& mesh, int index)
+{
+	int copy = (int) mesh.vertices.size();
+	mesh.vertices.push_back(mesh.vertices[index]);
+	if (!mesh.normals.empty())
+	{
+		mesh.normals.push_back(mesh.normals[index]);
+	}
+	if (!mesh.texcoord.empty())
+	{
+		mesh.texcoord.push_back(mesh.texcoord[index]);
+	}
+	return copy;
+}
+
+// ------------------------------------------------------------------------------
+// Moves the texture coordinates of every triangle by whole repeats, so that each
+// triangle starts inside [0,1]. This keeps the range of repeated textures small.
+// Vertices shared by triangles with different moves are split.
+// ------------------------------------------------------------------------------
+void normalizeTexcoordRepeats(Mesh& mesh)
+{
+	if (mesh.texcoord.empty())
+	{
+		return;
+	}
+
+	typedef std::pair<int, int> RepeatType;
+	const RepeatType unassigned(std::numeric_limits<int>::min(), 0);
+	std::vector<RepeatType> vertexRepeats(mesh.vertices.size(), unassigned);
+	std::map<std::pair<int, RepeatType>, int> splitVertices;
+
+	for(size_t c=0; c<mesh.components.size(); ++c)
+	{
+		std::vector<Vector3i>& faces = mesh.components[c].faces;
+		for(size_t f=0; f<faces.size(); ++f)
+		{
+			float minU = std::numeric_limits<float>::max();
+			float minV = std::numeric_limits<float>::max();
+			for(int i=0; i<3; ++i)
+			{
+				const Vector2f& texcoord = mesh.texcoord[faces[f].data[i]];
+				minU = std::min(minU, texcoord.data[0]);
+				minV = std::min(minV, texcoord.data[1]);
+			}
+			RepeatType repeat((int) floor(minU), (int) floor(minV));
 
-	Material& mat = outputMesh.materials["default"];
-	mat.textureDiffuse = textureFilename;
+			for(int i=0; i<3; ++i)
+			{
+				int& index = faces[f].data[i];
+				if (vertexRepeats[index] == unassigned)
+				{
+					vertexRepeats[index] = repeat;
+				}
+				else if (vertexRepeats[index] != repeat)
+				{
+					std::pair<int, RepeatType> key(index, repeat);
+					std::map<std::pair<int, RepeatType>, int>::iterator it = splitVertices.find(key);
+					if (it == splitVertices.end())
+					{
+						it = splitVertices.insert(std::make_pair(key, copyVertex(mesh, index))).first;
+						vertexRepeats.push_back(repeat);
+					}
+					index = it->second;
+				}
+			}
+		}
+	}
+
+	for(size_t v=0; v<vertexRepeats.size(); ++v)
+	{
+		if (vertexRepeats[v] != unassigned)
+		{
+			mesh.texcoord[v].data[0] -= float(vertexRepeats[v].first);
+			mesh.texcoord[v].data[1] -= float(vertexRepeats[v].second);
+		}
+	}
+}
+
+// ------------------------------------------------------------------------------
+// Assigns a tile transform slot to every vertex
+// Vertices used by components with different slots are split, so that every
+// component keeps its own copy of the vertex.
+// ------------------------------------------------------------------------------
+void assignVertexSlots(Mesh& mesh, const std::vector<int>& componentSlots, std::vector<int>& vertexSlots)
+{
+	vertexSlots.assign(mesh.vertices.size(), -1);
+	std::map<std::pair<int, int>, int> splitVertices;
+
+	for(size_t c=0; c<mesh.components.size(); ++c)
+	{
+		int slot = componentSlots[c];
+		std::vector<Vector3i>& faces = mesh.components[c].faces;
+		for(size_t f=0; f<faces.size(); ++f)
+		{
+			for(int i=0; i<3; ++i)
+			{
+				int& index = faces[f].data[i];
+				if (vertexSlots[index] < 0)
+				{
+					vertexSlots[index] = slot;
+				}
+				else if (vertexSlots[index] != slot)
+				{
+					std::pair<int, int> key(index, slot);
+					std::map<std::pair<int, int>, int>::iterator it = splitVertices.find(key);
+					if (it == splitVertices.end())
+					{
+						it = splitVertices.insert(std::make_pair(key, copyVertex(mesh, index))).first;
+						vertexSlots.push_back(slot);
+					}
+					index = it->second;
+				}
+			}
+		}
+	}
+
+	if (!splitVertices.empty())
+	{
+		std::cerr << "split " << splitVertices.size() << " vertices shared by differently textured components" << std::endl;
+	}
+}
+
+// ------------------------------------------------------------------------------
+// Applies the tile transform of each vertex to its texture coordinate
+// Slot 0 is the identity, vertices without a slot are left unchanged.
+// ------------------------------------------------------------------------------
+void transformTexcoords(std::vector<Vector2f>& texcoord, const std::vector<int>& vertexSlots, const std::vector<TileTransform>& slots)
+{
+	// Scale and offset of each slot, interleaved the same way as the texture coordinates
+	std::vector<float> table(4*slots.size());
+	for(size_t s=0; s<slots.size(); ++s)
+	{
+		table[4*s+0] = slots[s].ax;
+		table[4*s+1] = slots[s].ay;
+		table[4*s+2] = slots[s].bx;
+		table[4*s+3] = slots[s].by;
+	}
+
+	const int blockSize = 4096;
+	int count = (int) texcoord.size();
+	int blockCount = (count + blockSize - 1) / blockSize;
+
+	#pragma omp parallel for
+	for(int b=0; b<blockCount; ++b)
+	{
+		int begin = b*blockSize;
+		int end = std::min(begin + blockSize, count);
+		int i = begin;
+#ifdef BAKEOBJ_SSE2
+		// Two texture coordinates per iteration
+		for(; i+1<end; i+=2)
+		{
+			const float* t0 = &table[4*std::max(vertexSlots[i], 0)];
+			const float* t1 = &table[4*std::max(vertexSlots[i+1], 0)];
+			__m128 scale = _mm_loadh_pi(_mm_loadl_pi(_mm_setzero_ps(), (const __m64*) t0), (const __m64*) t1);
+			__m128 offset = _mm_loadh_pi(_mm_loadl_pi(_mm_setzero_ps(), (const __m64*) (t0+2)), (const __m64*) (t1+2));
+			float* uv = texcoord[i].data;
+			_mm_storeu_ps(uv, _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(uv), scale), offset));
+		}
+#endif
+		for(; i<end; ++i)
+		{
+			const float* t = &table[4*std::max(vertexSlots[i], 0)];
+			texcoord[i].data[0] = t[0]*texcoord[i].data[0] + t[2];
+			texcoord[i].data[1] = t[1]*texcoord[i].data[1] + t[3];
+		}
+	}
+}
+
+// ------------------------------------------------------------------------------
+// Decoded textures and the quad-tree they are packed into
+// ------------------------------------------------------------------------------
+class AtlasBuilderImpl
+{
+public:
+	typedef std::map<std::string, TextureTileLeafPtr> TextureMapType;
+	typedef std::map<std::string, unsigned long long> TextureHashMapType;
+	typedef std::map<std::string, std::string> TextureErrorMapType;
+	typedef std::map<TextureTileLeafPtr, ILuint> ScaledImageMapType;
+	typedef std::map<TextureTileLeafPtr, AlphaMode> LeafModeMapType;
+	struct MaskedTexture
+	{
+		TextureTileLeafPtr diffuse; //!< Decoded textures the masked texture was created from
+		TextureTileLeafPtr opacity;
+		TextureTileLeafPtr leaf;
+	};
+	typedef std::map<std::pair<std::string, std::string>, MaskedTexture> MaskedTextureMapType;
+	TextureMapType mTextures;
+	MaskedTextureMapType mMaskedTextures; //!< Diffuse textures with the alpha of their opacity map, by both filenames
+	TextureHashMapType mTextureHashes;
+	TextureErrorMapType mTextureErrors; //!< Textures that failed to decode ahead of packing, reported once a used material needs them
+	std::set<std::string> mUsedTextures; //!< Textures decoded or packed since the unused ones were last released
+	TextureTileTree mTree;
+	std::vector<TextureTileLeafPtr> mPackedLeaves;
+	std::vector<TextureTileLeafPtr> mMaterialTiles;
+	LeafModeMapType mLeafModes; //!< Alpha mode of the packed textures that materials were classified by
+	std::vector<AtlasRect> mTileRects;
+	ScaledImageMapType mScaledImages;
+	FileResolver* mResolver;
+	int mSizeX;
+	int mSizeY;
+	int mMaxSize;
+	PngOptions mPngOptions;
+public:
+	AtlasBuilderImpl()
+	{
+		mResolver = NULL;
+		mSizeX = 0;
+		mSizeY = 0;
+		mMaxSize = 0;
+	}
+	~AtlasBuilderImpl()
+	{
+		releaseScaledImages();
+	}
+	TextureTileLeafPtr getTexture(const std::string& filename)
+	{
+		mUsedTextures.insert(filename);
+		TextureMapType::iterator it = mTextures.find(filename);
+		if (it == mTextures.end())
+		{
+			TextureErrorMapType::const_iterator ie = mTextureErrors.find(filename);
+			if (ie != mTextureErrors.end())
+			{
+				throw std::runtime_error(ie->second);
+			}
+			return loadTexture(filename);
+		}
+		return it->second;
+	}
+	//! Returns a diffuse texture with an opacity map (map_d) in its alpha, if it has a separate one
+	//! Masked textures are created again when their diffuse texture or opacity map was decoded again.
+	TextureTileLeafPtr getTexture(const std::string& filename, const std::string& opacityFilename)
+	{
+		TextureTileLeafPtr diffuse = getTexture(filename);
+		if (opacityFilename.empty() || opacityFilename == filename)
+		{
+			return diffuse;
+		}
+		TextureTileLeafPtr opacity = getTexture(opacityFilename);
+
+		MaskedTexture& masked = mMaskedTextures[std::make_pair(filename, opacityFilename)];
+		if (!masked.leaf || masked.diffuse != diffuse || masked.opacity != opacity)
+		{
+			masked.leaf = TextureTileTree::maskLeaf(*diffuse, *opacity);
+			masked.diffuse = diffuse;
+			masked.opacity = opacity;
+		}
+		return masked.leaf;
+	}
+	TextureTileLeafPtr loadTexture(const std::string& filename)
+	{
+		mUsedTextures.insert(filename);
+		if (!mResolver)
+		{
+			TextureMapType::iterator it = mTextures.find(filename);
+			if (it == mTextures.end())
+			{
+				it = mTextures.insert(std::make_pair(filename, TextureTileTree::loadLeaf(filename))).first;
+			}
+			return it->second;
+		}
+
+		// Textures opened through a resolver are decoded again only when their contents changed
+		boost::shared_ptr<std::istream> stream = mResolver->open(filename);
+		if (!stream)
+		{
+			throw std::runtime_error("could not load texture file " + filename);
+		}
+		std::string data;
+		readStream(*stream, data);
+		unsigned long long hash = hashData(data.data(), data.size());
+
+		TextureMapType::iterator it = mTextures.find(filename);
+		TextureHashMapType::const_iterator ih = mTextureHashes.find(filename);
+		if (it != mTextures.end() && ih != mTextureHashes.end() && ih->second == hash)
+		{
+			return it->second;
+		}
+		TextureTileLeafPtr leaf = TextureTileTree::loadLeaf(filename, data);
+		mTextures[filename] = leaf;
+		mTextureHashes[filename] = hash;
+		return leaf;
+	}
+	//! Scaled tiles are resampled once when the atlas is rendered in parts
+	ILuint getScaledImage(const TextureTileLeafPtr& leaf)
+	{
+		ScaledImageMapType::iterator it = mScaledImages.find(leaf);
+		if (it == mScaledImages.end())
+		{
+			it = mScaledImages.insert(std::make_pair(leaf, createScaledImage(*leaf))).first;
+		}
+		return it->second;
+	}
+	void releaseScaledImages()
+	{
+		for(ScaledImageMapType::iterator it=mScaledImages.begin(); it!=mScaledImages.end(); ++it)
+		{
+			ilDeleteImages(1, &it->second);
+		}
+		mScaledImages.clear();
+	}
+	ILuint stitch();
+};
+
+AtlasBuilder::AtlasBuilder()
+	: mImpl(new AtlasBuilderImpl)
+{
+	ilInit();
+	ilEnable(IL_FILE_OVERWRITE);
+
+	// Decoded textures and created images count rows from the top, so that pixel copies match the encoded atlas
+	ilOriginFunc(IL_ORIGIN_UPPER_LEFT);
+	ilEnable(IL_ORIGIN_SET);
+}
+
+void AtlasBuilder::setMaxSize(int maxSize)
+{
+	mImpl->mMaxSize = maxSize;
+}
+
+void AtlasBuilder::setPngOptions(const PngOptions& options)
+{
+	mImpl->mPngOptions = options;
+}
+
+void AtlasBuilder::setResolver(FileResolver* resolver)
+{
+	mImpl->mResolver = resolver;
+}
+
+void AtlasBuilder::releaseUnusedTextures()
+{
+	AtlasBuilderImpl::TextureMapType::iterator it = mImpl->mTextures.begin();
+	while (it != mImpl->mTextures.end())
+	{
+		if (mImpl->mUsedTextures.find(it->first) == mImpl->mUsedTextures.end())
+		{
+			mImpl->mTextureHashes.erase(it->first);
+			mImpl->mTextures.erase(it++);
+		}
+		else
+		{
+			++it;
+		}
+	}
+	AtlasBuilderImpl::MaskedTextureMapType::iterator im = mImpl->mMaskedTextures.begin();
+	while (im != mImpl->mMaskedTextures.end())
+	{
+		if (mImpl->mTextures.find(im->first.first) == mImpl->mTextures.end() || mImpl->mTextures.find(im->first.second) == mImpl->mTextures.end())
+		{
+			mImpl->mMaskedTextures.erase(im++);
+		}
+		else
+		{
+			++im;
+		}
+	}
+	mImpl->mTextureErrors.clear();
+	mImpl->mUsedTextures.clear();
+}
+
+void AtlasBuilder::loadTextures(const MaterialMapType& materials)
+{
+	for(MaterialMapType::const_iterator im=materials.begin();im!=materials.end();++im)
+	{
+		// Textures of unused materials may be missing, so a failure only matters once packing needs the texture
+		// Opacity maps are only decoded with a diffuse texture whose alpha they replace
+		if (im->second.textureDiffuse.empty())
+		{
+			continue;
+		}
+		const std::string* filenames[2] = {&im->second.textureDiffuse, &im->second.textureTransparency};
+		for(int i=0; i<2; ++i)
+		{
+			const std::string& filename = *filenames[i];
+			if (filename.empty() || (i > 0 && filename == im->second.textureDiffuse))
+			{
+				continue;
+			}
+			try
+			{
+				mImpl->loadTexture(filename);
+				mImpl->mTextureErrors.erase(filename);
+			}
+			catch(std::runtime_error& e)
+			{
+				mImpl->mTextureErrors[filename] = e.what();
+			}
+		}
+	}
+}
+
+void AtlasBuilder::pack(const MaterialMapType& materials, const std::vector<std::string>& materialNames, const MaterialUsageListType& usage, AtlasLayoutType& layout)
+{
+	// Create a tree of all tiles
+	TextureTileTree& tileTree = mImpl->mTree;
+	tileTree = TextureTileTree();
+	mImpl->mPackedLeaves.clear();
+	mImpl->mLeafModes.clear();
+	mImpl->releaseScaledImages();
+
+	// Find the texture of each used material and the texture coordinate range used from each texture
+	// Material definitions are looked up by name once per material id, id 0 has no material
+	typedef std::map<TextureTileLeafPtr, MaterialUsage> TileUsageMapType;
+	std::vector<TextureTileLeafPtr> materialTiles(materialNames.size());
+	TileUsageMapType tileUsages;
+	for(size_t id=1; id<materialNames.size() && id<usage.size(); ++id)
+	{
+		if (!usage[id].used)
+		{
+			continue;
+		}
+		MaterialMapType::const_iterator im = materials.find(materialNames[id]);
+		if (im != materials.end() && !im->second.textureDiffuse.empty())
+		{
+			TextureTileLeafPtr leaf = mImpl->getTexture(im->second.textureDiffuse, im->second.textureTransparency);
+			if (tileUsages.find(leaf) == tileUsages.end())
+			{
+				mImpl->mPackedLeaves.push_back(leaf);
+			}
+			MaterialUsage& tileUsage = tileUsages[leaf];
+			tileUsage.bounds.add(usage[id].bounds);
+			tileUsage.surfaceArea += usage[id].surfaceArea;
+			tileUsage.texcoordArea += usage[id].texcoordArea;
+			materialTiles[id] = leaf;
+		}
+	}
+
+	// Crop each texture to its used part. Materials sharing a texture share the leaf
+	std::vector<MaterialUsage> leafUsages;
+	for(size_t i=0; i<mImpl->mPackedLeaves.size(); ++i)
+	{
+		const TextureTileLeafPtr& leaf = mImpl->mPackedLeaves[i];
+		leafUsages.push_back(tileUsages[leaf]);
+		cropToBounds(*leaf, leafUsages.back().bounds);
+	}
+
+	// Scale the textures down to fit the atlas budget
+	if (mImpl->mMaxSize > 0)
+	{
+		fitToBudget(mImpl->mPackedLeaves, leafUsages, mImpl->mMaxSize);
+	}
+
+	for(size_t i=0; i<mImpl->mPackedLeaves.size(); ++i)
+	{
+		tileTree.addLeaf(mImpl->mPackedLeaves[i]);
+	}
+
+	if (tileTree.size()==0)
+	{
+		throw std::runtime_error("no textures to pack");
+	}
+
+	// Combine tiles until only one image remains
+	TextureTileArrayType candidateTiles;
+	candidateTiles.reserve(8);
+	while(tileTree.size()>1)
+	{
+		// Find candidates to combine
+		TextureTilePtr smallestTile = tileTree.getSmallestTile();
+
+		candidateTiles.clear();
+		for(TextureTileTree::iterator it=tileTree.begin(); it!=tileTree.end(); ++it)
+		{
+			TextureTilePtr candidate = *it;
+			if (smallestTile->getMaxSize() == candidate->getMaxSize())
+			{
+				candidateTiles.push_back(candidate);
+			}
+		}
+
+		// Create a new tile
+		tileTree.addQuad(candidateTiles);
+	}
+
+	int totalSizeX = tileTree.front()->getSizeX();
+	int totalSizeY = tileTree.front()->getSizeY();
+	mImpl->mSizeX = totalSizeX;
+	mImpl->mSizeY = totalSizeY;
+
+	// Pixels covered by each texture, the cropped and scaled texture is placed at the top left corner of its tile
+	mImpl->mTileRects.resize(mImpl->mPackedLeaves.size());
+	for(size_t i=0; i<mImpl->mPackedLeaves.size(); ++i)
+	{
+		const TextureTileLeafPtr& leaf = mImpl->mPackedLeaves[i];
+		int offsetX, offsetY;
+		tileTree.getTileOffset(leaf, offsetX, offsetY);
+		AtlasRect& rect = mImpl->mTileRects[i];
+		rect.x = offsetX;
+		rect.y = totalSizeY-(offsetY+leaf->getSizeY());
+		rect.width = leaf->getScaledWidth();
+		rect.height = leaf->getScaledHeight();
+	}
+
+	// Compute the texture coordinate transform of each material
+	layout.assign(materialNames.size(), TileTransform());
+	for(size_t id=0; id<materialTiles.size(); ++id)
+	{
+		const TextureTileLeafPtr& leaf = materialTiles[id];
+		if (!leaf)
+		{
+			continue;
+		}
+		int tileSizeY = leaf->getSizeY();
+		int offsetX, offsetY;
+		tileTree.getTileOffset(leaf, offsetX, offsetY);
+
+		// The cropped and scaled texture is placed at the top left corner of its tile
+		double width = leaf->getExactWidth();
+		double height = leaf->getExactHeight();
+		double scaleX = leaf->getScaledWidth() / double(leaf->getCropWidth());
+		double scaleY = leaf->getScaledHeight() / double(leaf->getCropHeight());
+		TileTransform& transform = layout[id];
+		transform.bx = float((offsetX - leaf->getCropX()*scaleX) / totalSizeX);
+		transform.by = float((offsetY + tileSizeY - (height - leaf->getCropY())*scaleY) / totalSizeY);
+		transform.ax = float(width*scaleX / totalSizeX);
+		transform.ay = float(height*scaleY / totalSizeY);
+	}
+	mImpl->mMaterialTiles.swap(materialTiles);
+}
+
+void AtlasBuilder::classifyTexels(AlphaModeListType& modes, bool allTextured)
+{
+	// Materials sharing a texture share its classification
+	AtlasBuilderImpl::LeafModeMapType& leafModes = mImpl->mLeafModes;
+	const std::vector<TextureTileLeafPtr>& materialTiles = mImpl->mMaterialTiles;
+	for(size_t id=0; id<modes.size() && id<materialTiles.size(); ++id)
+	{
+		const TextureTileLeafPtr& leaf = materialTiles[id];
+		if (!leaf || modes[id] == alphaBlended || (!allTextured && modes[id] != alphaTested))
+		{
+			continue;
+		}
+		AtlasBuilderImpl::LeafModeMapType::iterator it = leafModes.find(leaf);
+		if (it == leafModes.end())
+		{
+			it = leafModes.insert(std::make_pair(leaf, classifyAlpha(*leaf))).first;
+		}
+		modes[id] = it->second;
+	}
+}
+
+void AtlasBuilder::getTextureSize(const std::string& filename, int& width, int& height)
+{
+	TextureTileLeafPtr leaf = mImpl->getTexture(filename);
+	width = leaf->getExactWidth();
+	height = leaf->getExactHeight();
+}
+
+void AtlasBuilder::renderTexture(const std::string& filename, const std::string& opacityFilename, int width, int height, std::vector<unsigned char>& pixels)
+{
+	TextureTileLeafPtr leaf = mImpl->getTexture(filename, opacityFilename);
+	int exactWidth = leaf->getExactWidth();
+	int exactHeight = leaf->getExactHeight();
+	std::vector<unsigned char> source(4*size_t(exactWidth)*size_t(exactHeight));
+	ilBindImage(leaf->getImage());
+	ilCopyPixels(0, 0, 0, exactWidth, exactHeight, 1, IL_RGBA, IL_UNSIGNED_BYTE, &source[0]);
+	if (width == exactWidth && height == exactHeight)
+	{
+		pixels.swap(source);
+		return;
+	}
+	pixels.resize(4*size_t(width)*size_t(height));
+	resampleImage(&source[0], exactWidth, exactHeight, &pixels[0], width, height);
+}
+
+AlphaMode AtlasBuilder::classifyTexture(const std::string& filename, const std::string& opacityFilename)
+{
+	TextureTileLeafPtr leaf = mImpl->getTexture(filename, opacityFilename);
+	return classifyAlpha(leaf->getImage(), 0, 0, leaf->getExactWidth(), leaf->getExactHeight());
+}
+
+// ------------------------------------------------------------------------------
+// Creates the atlas image from the packed textures, the caller deletes the image
+// ------------------------------------------------------------------------------
+ILuint AtlasBuilderImpl::stitch()
+{
+	const TextureTileTree& tileTree = mTree;
+	int totalSizeX = mSizeX;
+	int totalSizeY = mSizeY;
+
+	// Create the texture atlas
+	ILuint atlasImage;
+	ilGenImages(1, &atlasImage);
+	ilBindImage(atlasImage);
+	if(!createImage(totalSizeX, totalSizeY, NULL))
+	{
+		ilDeleteImages(1, &atlasImage);
+		throw std::runtime_error("could not create the output image");
+	}
+
+	ilDisable(IL_BLIT_BLEND);
+
+	// Stitch the texture atlas
+	for(size_t i=0; i<mPackedLeaves.size(); ++i)
+	{
+		const TextureTileLeafPtr& leaf = mPackedLeaves[i];
+		int offsetX, offsetY;
+		tileTree.getTileOffset(leaf, offsetX, offsetY);
+		blitPackedTile(*leaf, atlasImage, offsetX, offsetY, totalSizeY);
+	}
+	return atlasImage;
+}
+
+void AtlasBuilder::save(const std::string& textureFilename)
+{
+	ILuint atlasImage = mImpl->stitch();
+	bool saved = saveAtlasImage(atlasImage, textureFilename, mImpl->mPngOptions);
+	ilDeleteImages(1, &atlasImage);
+	if (!saved)
+	{
+		throw std::runtime_error("could not save the texture atlas " + textureFilename);
+	}
+}
+
+void AtlasBuilder::saveToMemory(std::string& data)
+{
+	ILuint atlasImage = mImpl->stitch();
+	encodeImage(atlasImage, mImpl->mPngOptions, data);
+	ilDeleteImages(1, &atlasImage);
+}
+
+void AtlasBuilder::getTileRects(std::vector<AtlasRect>& rects) const
+{
+	rects = mImpl->mTileRects;
+}
+
+// ------------------------------------------------------------------------------
+// Renders a rectangle of the atlas from some of the packed textures
+// ------------------------------------------------------------------------------
+void AtlasBuilder::renderRect(const AtlasRect& rect, const std::vector<size_t>& tiles, std::vector<unsigned char>& pixels)
+{
+	pixels.assign(4*size_t(rect.width)*size_t(rect.height), 0);
+
+	ILuint image;
+	ilGenImages(1, &image);
+	ilBindImage(image);
+	if(!createImage(rect.width, rect.height, &pixels[0]))
+	{
+		ilDeleteImages(1, &image);
+		throw std::runtime_error("could not create a temporary image");
+	}
+
+	ilDisable(IL_BLIT_BLEND);
+	for(size_t i=0; i<tiles.size(); ++i)
+	{
+		const TextureTileLeafPtr& leaf = mImpl->mPackedLeaves[tiles[i]];
+		const AtlasRect& tileRect = mImpl->mTileRects[tiles[i]];
+		if (leaf->isScaled())
+		{
+			ILuint scaledImage = mImpl->getScaledImage(leaf);
+			ilBindImage(image);
+			if(!blitClipped(scaledImage, tileRect.x-rect.x, tileRect.y-rect.y, 0, 0, tileRect.width, tileRect.height))
+			{
+				throw std::runtime_error("could not blit into the output image");
+			}
+		}
+		else
+		{
+			ilBindImage(image);
+			blitTile(*leaf, tileRect.x-rect.x, tileRect.y-rect.y);
+		}
+	}
+
+	ilBindImage(image);
+	ilCopyPixels(0, 0, 0, rect.width, rect.height, 1, IL_RGBA, IL_UNSIGNED_BYTE, &pixels[0]);
+	ilDeleteImages(1, &image);
+}
+
+void AtlasBuilder::getPlacement(AtlasPlacement& placement) const
+{
+	placement.sizeX = mImpl->mSizeX;
+	placement.sizeY = mImpl->mSizeY;
+	placement.tiles.resize(mImpl->mPackedLeaves.size());
+	for(size_t i=0; i<mImpl->mPackedLeaves.size(); ++i)
+	{
+		const TextureTileLeafPtr& leaf = mImpl->mPackedLeaves[i];
+		AtlasTile& tile = placement.tiles[i];
+		tile.filename = leaf->getFilename();
+		tile.hash = 0;
+		tile.opacityFilename = leaf->getOpacityFilename();
+		tile.opacityHash = 0;
+		tile.exactWidth = leaf->getExactWidth();
+		tile.exactHeight = leaf->getExactHeight();
+		tile.cropX = leaf->getCropX();
+		tile.cropY = leaf->getCropY();
+		tile.cropWidth = leaf->getCropWidth();
+		tile.cropHeight = leaf->getCropHeight();
+		tile.scaledWidth = leaf->getScaledWidth();
+		tile.scaledHeight = leaf->getScaledHeight();
+		mImpl->mTree.getTileOffset(leaf, tile.offsetX, tile.offsetY);
+		AtlasBuilderImpl::LeafModeMapType::const_iterator it = mImpl->mLeafModes.find(leaf);
+		tile.alphaMode = it != mImpl->mLeafModes.end() ? it->second : -1;
+	}
+}
+
+void AtlasBuilder::updateTiles(const std::string& textureFilename, const AtlasPlacement& placement, const std::vector<size_t>& changedTiles, bool& success)
+{
+	success = false;
+
+	// Decode the changed textures first, the atlas is only touched if all of them still fit
+	std::vector<TextureTileLeafPtr> leaves;
+	for(size_t i=0; i<changedTiles.size(); ++i)
+	{
+		const AtlasTile& tile = placement.tiles[changedTiles[i]];
+		TextureTileLeafPtr leaf = TextureTileTree::loadLeaf(tile.filename);
+		mImpl->mTextures[tile.filename] = leaf;
+		if (!tile.opacityFilename.empty())
+		{
+			TextureTileLeafPtr opacity = TextureTileTree::loadLeaf(tile.opacityFilename);
+			mImpl->mTextures[tile.opacityFilename] = opacity;
+			leaf = TextureTileTree::maskLeaf(*leaf, *opacity);
+		}
+		if (leaf->getExactWidth() != tile.exactWidth || leaf->getExactHeight() != tile.exactHeight)
+		{
+			return;
+		}
+		leaf->setCrop(tile.cropX, tile.cropY, tile.cropWidth, tile.cropHeight);
+		leaf->setScaledSize(tile.scaledWidth, tile.scaledHeight);
+
+		// Faces of a texture whose alpha mode changed move to another component, which takes a full bake
+		if (tile.alphaMode >= 0 && classifyAlpha(*leaf) != tile.alphaMode)
+		{
+			return;
+		}
+		leaves.push_back(leaf);
+	}
+
+	std::wstring wFilename;
+	wFilename.resize(textureFilename.size()+1,0);
+	std::copy(textureFilename.begin(), textureFilename.end(), wFilename.begin());
+
+	ILuint atlasImage;
+	ilGenImages(1, &atlasImage);
+	ilBindImage(atlasImage);
+	if(ilLoadImage(wFilename.c_str()) != IL_TRUE || ilConvertImage(IL_RGBA, IL_UNSIGNED_BYTE) != IL_TRUE ||
+		ilGetInteger(IL_IMAGE_WIDTH) != placement.sizeX || ilGetInteger(IL_IMAGE_HEIGHT) != placement.sizeY)
+	{
+		ilDeleteImages(1, &atlasImage);
+		return;
+	}
+
+	ilDisable(IL_BLIT_BLEND);
+	for(size_t i=0; i<leaves.size(); ++i)
+	{
+		const AtlasTile& tile = placement.tiles[changedTiles[i]];
+		blitPackedTile(*leaves[i], atlasImage, tile.offsetX, tile.offsetY, placement.sizeY);
+	}
+
+	bool saved = saveAtlasImage(atlasImage, textureFilename, mImpl->mPngOptions);
+	ilDeleteImages(1, &atlasImage);
+	if (!saved)
+	{
+		throw std::runtime_error("could not save the texture atlas " + textureFilename);
+	}
+	success = true;
+}
+
+void saveImage(const std::string& filename, const unsigned char* pixels, int width, int height)
+{
+	ILuint image;
+	ilGenImages(1, &image);
+	ilBindImage(image);
+	if(!createImage(width, height, pixels))
+	{
+		ilDeleteImages(1, &image);
+		throw std::runtime_error("could not create the output image");
+	}
+
+	std::wstring wFilename;
+	wFilename.resize(filename.size()+1,0);
+	std::copy(filename.begin(), filename.end(), wFilename.begin());
+
+	bool saved = ilSaveImage(wFilename.c_str()) == IL_TRUE;
+	ilDeleteImages(1, &image);
+	if (!saved)
+	{
+		throw std::runtime_error("could not save the image " + filename);
+	}
+}
+
+void saveImage(const std::string& filename, const unsigned char* pixels, int width, int height, const PngOptions& options)
+{
+	ILuint image;
+	ilGenImages(1, &image);
+	ilBindImage(image);
+	if(!createImage(width, height, pixels))
+	{
+		ilDeleteImages(1, &image);
+		throw std::runtime_error("could not create the output image");
+	}
+
+	bool saved = saveAtlasImage(image, filename, options);
+	ilDeleteImages(1, &image);
+	if (!saved)
+	{
+		throw std::runtime_error("could not save the image " + filename);
+	}
+}
+
+void TileTransform::setIdentity()
+{
+	ax = 1.0f;
+	bx = 0.0f;
+	ay = 1.0f;
+	by = 0.0f;
+}
+
+bool TileTransform::isIdentity() const
+{
+	return ax == 1.0f && bx == 0.0f && ay == 1.0f && by == 0.0f;
+}
+
+void TexcoordBounds::reset()
+{
+	min[0] = min[1] = std::numeric_limits<float>::max();
+	max[0] = max[1] = -std::numeric_limits<float>::max();
+}
+
+void TexcoordBounds::setFull()
+{
+	min[0] = min[1] = 0.0f;
+	max[0] = max[1] = 1.0f;
+}
+
+void TexcoordBounds::add(const Vector2f& texcoord)
+{
+	for(int i=0; i<2; ++i)
+	{
+		min[i] = std::min(min[i], texcoord.data[i]);
+		max[i] = std::max(max[i], texcoord.data[i]);
+	}
+}
+
+void TexcoordBounds::add(const TexcoordBounds& bounds)
+{
+	for(int i=0; i<2; ++i)
+	{
+		min[i] = std::min(min[i], bounds.min[i]);
+		max[i] = std::max(max[i], bounds.max[i]);
+	}
+}
+
+void collectUsedMaterials(const Mesh& mesh, MaterialUsageListType& usedMaterials)
+{
+	usedMaterials.assign(mesh.materialNames.size(), MaterialUsage());
+	for(ComponentListType::const_iterator ic=mesh.components.begin();ic!=mesh.components.end();++ic)
+	{
+		MaterialUsage& usage = usedMaterials[ic->materialId];
+		usage.used = true;
+		if (mesh.texcoord.empty())
+		{
+			continue;
+		}
+		for(size_t f=0; f<ic->faces.size(); ++f)
+		{
+			const Vector3i& face = ic->faces[f];
+			for(int i=0; i<3; ++i)
+			{
+				usage.bounds.add(mesh.texcoord[face.data[i]]);
+			}
+
+			// Triangle areas in space and in texture coordinates
+			const float* p0 = mesh.vertices[face.data[0]].data;
+			const float* p1 = mesh.vertices[face.data[1]].data;
+			const float* p2 = mesh.vertices[face.data[2]].data;
+			double e1[3] = {p1[0]-p0[0], p1[1]-p0[1], p1[2]-p0[2]};
+			double e2[3] = {p2[0]-p0[0], p2[1]-p0[1], p2[2]-p0[2]};
+			double cross[3] = {e1[1]*e2[2]-e1[2]*e2[1], e1[2]*e2[0]-e1[0]*e2[2], e1[0]*e2[1]-e1[1]*e2[0]};
+			usage.surfaceArea += 0.5*sqrt(cross[0]*cross[0] + cross[1]*cross[1] + cross[2]*cross[2]);
+
+			const float* t0 = mesh.texcoord[face.data[0]].data;
+			const float* t1 = mesh.texcoord[face.data[1]].data;
+			const float* t2 = mesh.texcoord[face.data[2]].data;
+			usage.texcoordArea += 0.5*fabs(double(t1[0]-t0[0])*(t2[1]-t0[1]) - double(t1[1]-t0[1])*(t2[0]-t0[0]));
+		}
+	}
+}
+
+void packAtlas(const MaterialMapType& materials, const std::vector<std::string>& materialNames, const MaterialUsageListType& usage, const std::string& textureFilename, AtlasLayoutType& layout, int maxAtlasSize, const PngOptions& pngOptions)
+{
+	AtlasBuilder atlas;
+	atlas.setMaxSize(maxAtlasSize);
+	atlas.setPngOptions(pngOptions);
+	atlas.pack(materials, materialNames, usage, layout);
+	atlas.save(textureFilename);
+}
+
+void classifyMaterials(const Mesh& mesh, AlphaModeListType& modes)
+{
+	modes.assign(mesh.materialNames.size(), alphaOpaque);
+	for(size_t id=1; id<mesh.materialNames.size(); ++id)
+	{
+		MaterialMapType::const_iterator im = mesh.materials.find(mesh.materialNames[id]);
+		if (im == mesh.materials.end())
+		{
+			continue;
+		}
+		if (im->second.transparency < 1.0f)
+		{
+			modes[id] = alphaBlended;
+		}
+		else if (!im->second.textureTransparency.empty())
+		{
+			modes[id] = alphaTested;
+		}
+	}
+}
+
+void bakeTexcoords(Mesh& mesh, const AtlasLayoutType& layout, const AlphaModeListType& modes, const std::string& textureFilename, const std::string& blendedPrefix)
+{
+	size_t faceCount = 0;
+	for(ComponentListType::const_iterator ic=mesh.components.begin();ic!=mesh.components.end();++ic)
+	{
+		faceCount += ic->faces.size();
+	}
+
+	// Assign a transform slot to every material, slot 0 is the identity
+	std::vector<TileTransform> slots(1);
+	std::vector<int> materialSlots(layout.size(), 0);
+	for(size_t id=0; id<layout.size(); ++id)
+	{
+		if (!layout[id].isIdentity())
+		{
+			materialSlots[id] = (int) slots.size();
+			slots.push_back(layout[id]);
+		}
+	}
+	std::vector<int> componentSlots(mesh.components.size(), 0);
+	for(size_t c=0; c<mesh.components.size(); ++c)
+	{
+		int id = mesh.components[c].materialId;
+		componentSlots[c] = id < (int) materialSlots.size() ? materialSlots[id] : 0;
+	}
+
+	// Transform texture coordinates in place
+	std::vector<int> vertexSlots;
+	assignVertexSlots(mesh, componentSlots, vertexSlots);
+	transformTexcoords(mesh.texcoord, vertexSlots, slots);
+
+	// Alpha mode of each component, blended faces are grouped by the transparency of their material
+	const int modeCount = alphaBlended+1;
+	size_t modeFaceCounts[modeCount] = {0, 0, 0};
+	std::vector<AlphaMode> componentModes(mesh.components.size(), alphaOpaque);
+	std::vector<float> componentTransparencies(mesh.components.size(), 1.0f);
+	std::set<float, std::greater<float> > transparencies;
+	for(size_t c=0; c<mesh.components.size(); ++c)
+	{
+		const MeshComponent& component = mesh.components[c];
+		int id = component.materialId;
+		componentModes[c] = id < (int) modes.size() ? modes[id] : alphaOpaque;
+		modeFaceCounts[componentModes[c]] += component.faces.size();
+		if (componentModes[c] == alphaBlended && !component.faces.empty())
+		{
+			MaterialMapType::const_iterator im = mesh.materials.find(mesh.materialNames[id]);
+			componentTransparencies[c] = im != mesh.materials.end() ? im->second.transparency : 1.0f;
+			transparencies.insert(componentTransparencies[c]);
+		}
+	}
+
+	// Output components: opaque, alpha tested, then one blended component per transparency from the most opaque
+	std::vector<float> blendedTransparencies(transparencies.begin(), transparencies.end());
+	size_t outputCount = alphaBlended + std::max<size_t>(blendedTransparencies.size(), 1);
+	std::vector<size_t> componentOutputs(mesh.components.size());
+	std::vector<size_t> outputFaceCounts(outputCount, 0);
+	for(size_t c=0; c<mesh.components.size(); ++c)
+	{
+		size_t output = componentModes[c];
+		if (componentModes[c] == alphaBlended)
+		{
+			output += std::lower_bound(blendedTransparencies.begin(), blendedTransparencies.end(), componentTransparencies[c], std::greater<float>()) - blendedTransparencies.begin();
+		}
+		componentOutputs[c] = std::min(output, outputCount-1);
+		outputFaceCounts[componentOutputs[c]] += mesh.components[c].faces.size();
+	}
+
+	// Merge the components of each output into one, taking over the face list of the first component
+	// Opaque faces keep the name "default", so meshes without transparency bake into a single component as before
+	std::vector<std::vector<Vector3i> > outputFaces(outputCount);
+	for(size_t c=0; c<mesh.components.size(); ++c)
+	{
+		std::vector<Vector3i>& faces = outputFaces[componentOutputs[c]];
+		if (faces.empty())
+		{
+			faces.swap(mesh.components[c].faces);
+			faces.reserve(outputFaceCounts[componentOutputs[c]]);
+		}
+		else
+		{
+			faces.insert(faces.end(), mesh.components[c].faces.begin(), mesh.components[c].faces.end());
+			std::vector<Vector3i>().swap(mesh.components[c].faces);
+		}
+	}
+	mesh.components.clear();
+	mesh.materials.clear();
+	mesh.materialNames.assign(1, std::string());
+
+	const char* modeNames[modeCount] = {"default", "alphaTested", "blended"};
+	for(size_t o=0; o<outputCount; ++o)
+	{
+		int m = (int) std::min<size_t>(o, alphaBlended);
+		if (outputFaces[o].empty() && (m != alphaOpaque || faceCount > 0))
+		{
+			continue;
+		}
+		std::ostringstream name;
+		if (m == alphaBlended)
+		{
+			name << blendedPrefix;
+		}
+		name << modeNames[m];
+		if (m == alphaBlended && blendedTransparencies.size() > 1)
+		{
+			name << o - alphaBlended + 1;
+		}
+		mesh.components.push_back(MeshComponent());
+		MeshComponent& component = mesh.components.back();
+		component.componentName = name.str();
+		component.materialId = (int) mesh.materialNames.size();
+		component.faces.swap(outputFaces[o]);
+
+		// All materials sample the atlas, the others also take their opacity from its alpha
+		mesh.materialNames.push_back(name.str());
+		Material& mat = mesh.materials[name.str()];
+		mat.textureDiffuse = textureFilename;
+		if (m != alphaOpaque)
+		{
+			mat.textureTransparency = textureFilename;
+		}
+		if (m == alphaBlended)
+		{
+			mat.transparency = blendedTransparencies[o - alphaBlended];
+		}
+	}
+
+	if (modeFaceCounts[alphaTested] > 0 || modeFaceCounts[alphaBlended] > 0)
+	{
+		std::cerr << "split faces into " << modeFaceCounts[alphaOpaque] << " opaque, " << modeFaceCounts[alphaTested]
+			<< " alpha tested and " << modeFaceCounts[alphaBlended] << " blended";
+		if (blendedTransparencies.size() > 1)
+		{
+			std::cerr << " in " << blendedTransparencies.size() << " materials by transparency";
+		}
+		std::cerr << std::endl;
+	}
+}
+
+void packTextures(Mesh& mesh, const std::string& textureFilename)
+{
+	// Collect all actually used materials
+	normalizeTexcoordRepeats(mesh);
+	MaterialUsageListType usedMaterials;
+	collectUsedMaterials(mesh, usedMaterials);
+
+	// Build the texture atlas
+	AtlasBuilder atlas;
+	AtlasLayoutType layout;
+	atlas.pack(mesh.materials, mesh.materialNames, usedMaterials, layout);
+	atlas.save(textureFilename);
+
+	AlphaModeListType alphaModes;
+	classifyMaterials(mesh, alphaModes);
+	atlas.classifyTexels(alphaModes, false);
+	bakeTexcoords(mesh, layout, alphaModes, textureFilename);
+}
+
+void packTextures(const Mesh& inputMesh, Mesh& outputMesh, const std::string& textureFilename)
+{
+	outputMesh = inputMesh;
+	packTextures(outputMesh, textureFilename);
 }
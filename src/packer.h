@@ -1,3 +1,184 @@
+#ifndef PACKER_H
+#define PACKER_H
+
 #include "objTypes.h"
+#include "pngEncoder.h"
+
+#include <boost/shared_ptr.hpp>
+
+class FileResolver;
+
+//! Affine transform of a material's texture coordinates into its tile of the atlas
+struct TileTransform
+{
+	float ax;
+	float bx;
+	float ay;
+	float by;
+	TileTransform()
+	{
+		setIdentity();
+	}
+	void setIdentity();
+	bool isIdentity() const;
+};
+
+//! Transform of each material id, materials without a packed texture keep the identity
+typedef std::vector<TileTransform> AtlasLayoutType;
+
+//! Range of texture coordinates used by a material
+struct TexcoordBounds
+{
+	float min[2];
+	float max[2];
+	TexcoordBounds()
+	{
+		reset();
+	}
+	void reset();
+	void setFull();
+	void add(const Vector2f& texcoord);
+	void add(const TexcoordBounds& bounds);
+	bool isEmpty() const { return min[0] > max[0]; }
+};
+
+//! Texture coordinate range and areas covered by the faces of a material
+struct MaterialUsage
+{
+	bool           used;         //!< Whether any component uses the material
+	TexcoordBounds bounds;
+	double         surfaceArea;  //!< Surface area of the faces
+	double         texcoordArea; //!< Area of the faces in texture coordinates
+	MaterialUsage()
+	{
+		used = false;
+		surfaceArea = 0.0;
+		texcoordArea = 0.0;
+	}
+};
+
+//! Usage of each material id
+typedef std::vector<MaterialUsage> MaterialUsageListType;
 
+//! How the faces of a material are composited, the baked mesh gets one component per mode
+enum AlphaMode
+{
+	alphaOpaque = 0,
+	alphaTested,  //!< Texels are either transparent or opaque, drawn with alpha testing
+	alphaBlended  //!< Partial transparency, drawn sorted with blending
+};
+
+//! Alpha mode of each material id
+typedef std::vector<AlphaMode> AlphaModeListType;
+
+//! Placement of a packed texture in the atlas, in pixels
+struct AtlasTile
+{
+	std::string        filename;
+	unsigned long long hash;         //!< Hash of the texture file, not filled in by the atlas builder
+	std::string        opacityFilename; //!< Opacity map baked into the alpha of the texture, empty if none
+	unsigned long long opacityHash;  //!< Hash of the opacity map, not filled in by the atlas builder
+	int                exactWidth;
+	int                exactHeight;
+	int                cropX;
+	int                cropY;
+	int                cropWidth;
+	int                cropHeight;
+	int                scaledWidth;
+	int                scaledHeight;
+	int                offsetX;
+	int                offsetY;
+	int                alphaMode;    //!< AlphaMode of the cropped texels, -1 if no material was classified by them
+};
+
+//! Placement of all packed textures, enough to update an atlas whose textures changed but kept their sizes
+struct AtlasPlacement
+{
+	int                    sizeX;
+	int                    sizeY;
+	std::vector<AtlasTile> tiles;
+};
+
+//! Rectangle of atlas pixels, rows are counted from the top of the atlas image
+struct AtlasRect
+{
+	int x;
+	int y;
+	int width;
+	int height;
+};
+
+class AtlasBuilderImpl;
+
+//! Builds a texture atlas in three steps, so that decoding can start before the mesh is loaded
+//! All methods use DevIL and must not be called concurrently.
+class AtlasBuilder
+{
+private:
+	boost::shared_ptr<AtlasBuilderImpl> mImpl;
+public:
+	AtlasBuilder();
+	//! Limits the atlas size, textures are scaled down to a common texel density to fit (0 for no limit)
+	void setMaxSize(int maxSize);
+	//! Sets the compression of png atlases, they are encoded on all cores
+	void setPngOptions(const PngOptions& options);
+	//! Reads the textures through a resolver instead of loading them from disk (NULL to load from disk)
+	//! Textures read through a resolver are decoded again when their contents changed
+	void setResolver(FileResolver* resolver);
+	//! Decodes the diffuse textures and opacity maps of the given materials, textures are decoded only once
+	void loadTextures(const MaterialMapType& materials);
+	//! Releases the decoded textures that were neither decoded nor packed since the last call,
+	//! so that a builder kept between bakes only holds the textures of the last one
+	void releaseUnusedTextures();
+	//! Packs the textures of the used materials into one tile tree and computes their transforms
+	//! Each texture is cropped to the texture coordinate range used by its materials.
+	//! Materials are identified by their index into materialNames, the usage and the layout use the same ids.
+	void pack(const MaterialMapType& materials, const std::vector<std::string>& materialNames, const MaterialUsageListType& usage, AtlasLayoutType& layout);
+	//! Reclassifies the materials of the last pack by the alpha channel of their cropped textures
+	//! Only the atlas alpha reaches the baked material, so textures without transparent texels make a material
+	//! opaque. Opacity maps (map_d) are baked into the alpha of their diffuse texture. Alpha tested materials are
+	//! always reclassified, the other textured materials only with allTextured. Blended materials and materials
+	//! without texture keep their mode.
+	void classifyTexels(AlphaModeListType& modes, bool allTextured);
+	//! Returns the size of a texture, decoding it if needed
+	void getTextureSize(const std::string& filename, int& width, int& height);
+	//! Renders a whole texture into 32bit RGBA pixels with rows from the top, scaled to the given size
+	//! The alpha is taken from the opacity map, unless its filename is empty or the texture itself.
+	void renderTexture(const std::string& filename, const std::string& opacityFilename, int width, int height, std::vector<unsigned char>& pixels);
+	//! Classifies a whole texture with the alpha of its opacity map by its texels, the same way as classifyTexels
+	AlphaMode classifyTexture(const std::string& filename, const std::string& opacityFilename);
+	//! Stitches the packed textures and saves the atlas image
+	void save(const std::string& textureFilename);
+	//! Stitches the packed textures and encodes the atlas as a png image in memory
+	void saveToMemory(std::string& data);
+	//! Returns where the packed textures were placed
+	void getPlacement(AtlasPlacement& placement) const;
+	//! Returns the pixels covered by each packed texture, in the order of the placement tiles
+	void getTileRects(std::vector<AtlasRect>& rects) const;
+	//! Renders a rectangle of the atlas from the given placement tiles into 32bit RGBA pixels with rows from the top, without stitching the whole atlas
+	//! The rectangle may extend past the atlas, pixels not covered by the given tiles are transparent black.
+	void renderRect(const AtlasRect& rect, const std::vector<size_t>& tiles, std::vector<unsigned char>& pixels);
+	//! Decodes the given tiles of a placement again and blits them into the saved atlas, the other pixels are kept
+	//! Fails without touching the atlas if a texture or the atlas does not have the size recorded in the placement,
+	//! or if the texels of a texture no longer have the recorded alpha mode
+	void updateTiles(const std::string& textureFilename, const AtlasPlacement& placement, const std::vector<size_t>& changedTiles, bool& success);
+};
+
+//! Saves 32bit RGBA pixels with rows from the top as an image, must be called from the thread that uses the atlas builders
+void saveImage(const std::string& filename, const unsigned char* pixels, int width, int height);
+//! Same as saveImage, but png files are encoded on all cores with the given options
+void saveImage(const std::string& filename, const unsigned char* pixels, int width, int height, const PngOptions& options);
+void transformTexcoord(Vector2f& out, const Vector2f& in, const TileTransform& transform);
+void packAtlas(const MaterialMapType& materials, const std::vector<std::string>& materialNames, const MaterialUsageListType& usage, const std::string& textureFilename, AtlasLayoutType& layout, int maxAtlasSize = 0, const PngOptions& pngOptions = PngOptions());
+void normalizeTexcoordRepeats(Mesh& mesh);
+void collectUsedMaterials(const Mesh& mesh, MaterialUsageListType& usage);
+//! Classifies materials by their d value and opacity map, materials with an opacity map need classifyTexels
+void classifyMaterials(const Mesh& mesh, AlphaModeListType& modes);
+//! Transforms the texture coordinates into the atlas and merges the components by alpha mode
+//! Blended faces get one material per transparency of their materials, named blendedPrefix + "blended", followed by
+//! a number from the most opaque one if there are several, so meshes of a shared bake keep their own transparency.
+void bakeTexcoords(Mesh& mesh, const AtlasLayoutType& layout, const AlphaModeListType& modes, const std::string& textureFilename, const std::string& blendedPrefix = std::string());
+void packTextures(Mesh& mesh, const std::string& textureFilename);
 void packTextures(const Mesh& inputMesh, Mesh& outputMesh, const std::string& textureFilename);
+
+#endif
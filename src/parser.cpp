@@ -1,8 +1,13 @@
 #include "parser.h"
+#include "inputStream.h"
+#include "resolver.h"
+#include "normals.h"
 #include <iostream>
 #include <fstream>
 #include <sstream>
 #include <algorithm>
+#include <cmath>
+#include <cstdlib>
 
 const bool normalizeNormals = true;
 
@@ -71,12 +76,21 @@ inline bool parseWhitespace(const char*& str)
 }
 
 //=================================================================================================
-// Consumes a number
+// Consumes a number with an optional minus sign
 //=================================================================================================
 bool parseNumber(const char*& str, int& result)
 {
+	const char* start = str;
+	bool isNegative = false;
+	if (*str == '-')
+	{
+		isNegative = true;
+		str++;
+	}
+
 	if (!isDecimal(*str))
 	{
+		str = start;
 		return false;
 	}
 
@@ -87,9 +101,23 @@ bool parseNumber(const char*& str, int& result)
 		str++;
 	}
 
+	if (isNegative)
+	{
+		result = -result;
+	}
+
 	return true;
 }
 
+//=================================================================================================
+// Converts a relative (negative) index to an absolute one
+// Relative indices count backwards from the most recently defined element, -1 being the last one
+//=================================================================================================
+inline int resolveIndex(int index, int count)
+{
+	return index < 0 ? count + index + 1 : index;
+}
+
 //=================================================================================================
 // Consumes a vertex definition inside a face definition
 //=================================================================================================
@@ -118,22 +146,24 @@ bool parseVertex(const char*& str, int& vertex, int& normal, int& texcoord)
 
 //=================================================================================================
 // Consumes a face definition
+// Relative indices are resolved against the number of vertices, normals and texture coordinates
+// defined so far
 //=================================================================================================
-bool parseFace(const char*& str, Vector3i* indices, int& vertexCount, int maxVertexCount)
+bool parseFace(const char*& str, std::vector<Vector3i>& indices, int vertexCount, int normalCount, int texcoordCount)
 {
 	parseWhitespace(str);
 
-	vertexCount = 0;
+	indices.clear();
 
 	int indexV = 0, indexN = 0, indexT = 0;
 
-	while(parseVertex(str, indexV, indexN, indexT) && vertexCount < maxVertexCount)
+	while(parseVertex(str, indexV, indexN, indexT))
 	{
-		indices[vertexCount].data[0] = indexV;
-		indices[vertexCount].data[1] = indexN;
-		indices[vertexCount].data[2] = indexT;
-
-		vertexCount++;
+		Vector3i index;
+		index.data[0] = resolveIndex(indexV, vertexCount);
+		index.data[1] = resolveIndex(indexN, normalCount);
+		index.data[2] = resolveIndex(indexT, texcoordCount);
+		indices.push_back(index);
 
 		parseWhitespace(str);
 	}
@@ -141,6 +171,153 @@ bool parseFace(const char*& str, Vector3i* indices, int& vertexCount, int maxVer
 	return true;
 }
 
+//=================================================================================================
+// Twice the signed area of the 2D triangle (a,b,c), positive for counter-clockwise triangles
+//=================================================================================================
+inline float signedArea(const Vector2f& a, const Vector2f& b, const Vector2f& c)
+{
+	return (b.data[0]-a.data[0])*(c.data[1]-a.data[1]) - (b.data[1]-a.data[1])*(c.data[0]-a.data[0]);
+}
+
+//=================================================================================================
+// Check if the point p lies inside or on the counter-clockwise 2D triangle (a,b,c)
+//=================================================================================================
+inline bool isInsideTriangle(const Vector2f& p, const Vector2f& a, const Vector2f& b, const Vector2f& c)
+{
+	return signedArea(a, b, p) >= 0.0f && signedArea(b, c, p) >= 0.0f && signedArea(c, a, p) >= 0.0f;
+}
+
+//=================================================================================================
+// Projects a planar 3D polygon to a counter-clockwise 2D polygon
+// The dominant axis of the Newell normal is dropped
+//=================================================================================================
+void projectPolygon(const std::vector<Vector3f>& polygon, std::vector<Vector2f>& result)
+{
+	size_t n = polygon.size();
+
+	// Newell normal of the polygon
+	float normal[3] = {0.0f, 0.0f, 0.0f};
+	for(size_t i=0; i<n; ++i)
+	{
+		const float* a = polygon[i].data;
+		const float* b = polygon[(i+1)%n].data;
+		normal[0] += (a[1]-b[1])*(a[2]+b[2]);
+		normal[1] += (a[2]-b[2])*(a[0]+b[0]);
+		normal[2] += (a[0]-b[0])*(a[1]+b[1]);
+	}
+
+	int axis = 2;
+	if (fabs(normal[0]) > fabs(normal[1]) && fabs(normal[0]) > fabs(normal[2]))
+	{
+		axis = 0;
+	}
+	else if (fabs(normal[1]) > fabs(normal[2]))
+	{
+		axis = 1;
+	}
+	int axisU = (axis+1)%3;
+	int axisV = (axis+2)%3;
+	float sign = normal[axis] < 0.0f ? -1.0f : 1.0f;
+
+	result.resize(n);
+	for(size_t i=0; i<n; ++i)
+	{
+		result[i].data[0] = polygon[i].data[axisU];
+		result[i].data[1] = sign*polygon[i].data[axisV];
+	}
+}
+
+//=================================================================================================
+// Splits a polygon into triangles
+// Convex polygons are split into a fan, all other polygons are split by ear clipping.
+// The result contains three polygon corner indices per triangle.
+//=================================================================================================
+void triangulatePolygon(const std::vector<Vector3f>& polygon, std::vector<int>& triangles)
+{
+	triangles.clear();
+
+	int n = (int) polygon.size();
+	if (n < 3)
+	{
+		return;
+	}
+
+	std::vector<Vector2f> projected;
+	projectPolygon(polygon, projected);
+
+	// Convex polygons (the common case for quads) are split into a fan
+	bool isConvex = true;
+	for(int i=0; i<n && isConvex; ++i)
+	{
+		isConvex = signedArea(projected[i], projected[(i+1)%n], projected[(i+2)%n]) >= 0.0f;
+	}
+	if (isConvex)
+	{
+		for(int i=1; i<n-1; ++i)
+		{
+			triangles.push_back(0);
+			triangles.push_back(i);
+			triangles.push_back(i+1);
+		}
+		return;
+	}
+
+	// Ear clipping for concave polygons
+	std::vector<int> remaining(n);
+	for(int i=0; i<n; ++i)
+	{
+		remaining[i] = i;
+	}
+
+	while(remaining.size() > 3)
+	{
+		int count = (int) remaining.size();
+		int ear = -1;
+		for(int i=0; i<count && ear<0; ++i)
+		{
+			const Vector2f& a = projected[remaining[(i+count-1)%count]];
+			const Vector2f& b = projected[remaining[i]];
+			const Vector2f& c = projected[remaining[(i+1)%count]];
+
+			// Reflex corners can not be ears
+			if (signedArea(a, b, c) <= 0.0f)
+			{
+				continue;
+			}
+
+			// No other corner may lie inside the ear
+			bool isEar = true;
+			for(int j=0; j<count && isEar; ++j)
+			{
+				if (j==i || j==(i+count-1)%count || j==(i+1)%count)
+				{
+					continue;
+				}
+				isEar = !isInsideTriangle(projected[remaining[j]], a, b, c);
+			}
+			if (isEar)
+			{
+				ear = i;
+			}
+		}
+
+		// Degenerate or self-intersecting polygons have no ears, clip anyway to guarantee progress
+		if (ear < 0)
+		{
+			ear = 0;
+		}
+
+		triangles.push_back(remaining[(ear+count-1)%count]);
+		triangles.push_back(remaining[ear]);
+		triangles.push_back(remaining[(ear+1)%count]);
+		remaining.erase(remaining.begin() + ear);
+	}
+
+	triangles.push_back(remaining[0]);
+	triangles.push_back(remaining[1]);
+	triangles.push_back(remaining[2]);
+}
+
 //=================================================================================================
 // Parial ordering of faces
 //=================================================================================================
@@ -181,6 +358,15 @@ bool parseColor(std::istringstream& stream, Vector3f& color)
 	return true;
 }
 
+//=================================================================================================
+// Parses a texture name, relative names are relative to the material library
+//=================================================================================================
+void parseTextureFilename(std::istringstream& stream, const std::string& materialFilename, std::string& texture)
+{
+	stream >> texture;
+	texture = resolveRelativeFilename(materialFilename, texture);
+}
+
 //=================================================================================================
 // Loads a material
 // newmtl materialName
@@ -195,13 +381,16 @@ bool parseColor(std::istringstream& stream, Vector3f& color)
 void loadMaterialFile(const std::string& filename, MaterialMapType& materials)
 {
 	// Open the file
-	std::ifstream infile;
-	infile.open(filename.c_str());
-	if(!infile.is_open())
+	boost::shared_ptr<std::istream> infile = openInputFile(filename);
+	if(!infile)
 	{
 		throw std::runtime_error("Unable to open material file: " + filename);
 	}
+	loadMaterialFile(*infile, filename, materials);
+}
 
+void loadMaterialFile(std::istream& infile, const std::string& filename, MaterialMapType& materials)
+{
 	std::string line;
 	int linecount = 0;
 	Material currentMaterial;
@@ -268,27 +457,27 @@ void loadMaterialFile(const std::string& filename, MaterialMapType& materials)
 		}
 		else if (type == "map_kd")
 		{
-			stream >> currentMaterial.textureDiffuse;
+			parseTextureFilename(stream, filename, currentMaterial.textureDiffuse);
 		}
 		else if (type == "map_ks")
 		{
-			stream >> currentMaterial.textureSpecular;
+			parseTextureFilename(stream, filename, currentMaterial.textureSpecular);
 		}
 		else if (type == "map_ka")
 		{
-			stream >> currentMaterial.textureAmbient;
+			parseTextureFilename(stream, filename, currentMaterial.textureAmbient);
 		}
 		else if (type == "map_ke")
 		{
-			stream >> currentMaterial.textureEmissive;
+			parseTextureFilename(stream, filename, currentMaterial.textureEmissive);
 		}
 		else if (type == "map_bump" || type == "bump")
 		{
-			stream >> currentMaterial.textureBump;
+			parseTextureFilename(stream, filename, currentMaterial.textureBump);
 		}
 		else if (type == "map_d" || type == "map_tr")
 		{
-			stream >> currentMaterial.textureTransparency;
+			parseTextureFilename(stream, filename, currentMaterial.textureTransparency);
 		}
 		else
 		{
@@ -309,18 +498,22 @@ void loadMaterialFile(const std::string& filename, MaterialMapType& materials)
 //=================================================================================================
 // Loads an obj file
 //=================================================================================================
-void loadObj(const std::string& filename, Mesh& result)
-{	
-	// Clear the result
-	result.reset();
-
+void loadObj(const std::string& filename, Mesh& result, const MaterialsLoadedCallback& materialsLoaded, float creaseAngle)
+{
 	// Open the file
-	std::ifstream infile;
-	infile.open(filename.c_str());
-	if(!infile.is_open())
+	DiskFileResolver resolver;
+	boost::shared_ptr<std::istream> infile = resolver.open(filename);
+	if(!infile)
 	{
 		throw std::runtime_error("Unable to open mesh file: " + filename);
 	}
+	loadObj(*infile, filename, resolver, result, materialsLoaded, creaseAngle);
+}
+
+void loadObj(std::istream& infile, const std::string& filename, FileResolver& resolver, Mesh& result, const MaterialsLoadedCallback& materialsLoaded, float creaseAngle)
+{	
+	// Clear the result
+	result.reset();
 
 	std::string line;
 	bool hasNormals = false;
@@ -333,6 +526,22 @@ void loadObj(const std::string& filename, Mesh& result)
 	std::vector<Vector2f> texcoord;
 	std::map<Vector3i, int, CompareFaces> uniqueVertexMap;
 
+	// Material names are interned into ids when first used
+	std::map<std::string, int> materialIds;
+	std::string materialName;
+
+	// Obj position of each mesh vertex and smoothing group of each face, for generating normals
+	// Faces before the first smoothing group command are smoothed
+	std::vector<int> sourceVertices;
+	std::vector<int> smoothingGroups;
+	int smoothingGroup = 1;
+
+	// Per-face scratch buffers, reused to avoid allocations for every face
+	std::vector<Vector3i> loadedIndices;
+	std::vector<int> mappedIndices;
+	std::vector<Vector3f> polygon;
+	std::vector<int> triangles;
+
 	// Loop over all lines
 	int unsupportedTypeWarningsLeft = 10;
 	int linecount = 0;
@@ -357,8 +566,22 @@ void loadObj(const std::string& filename, Mesh& result)
 		{
 			std::string materialFileName;
 			stream >> materialFileName;
-			// FIXME: handle relative and absolute file names
-			loadMaterialFile(materialFileName, result.materials);
+			materialFileName = resolveRelativeFilename(filename, materialFileName);
+			boost::shared_ptr<std::istream> matfile = resolver.open(materialFileName);
+			if(!matfile)
+			{
+				throw std::runtime_error("Unable to open material file: " + materialFileName);
+			}
+			MaterialMapType materials;
+			loadMaterialFile(*matfile, materialFileName, materials);
+			if (materialsLoaded)
+			{
+				materialsLoaded(materials);
+			}
+			for(MaterialMapType::const_iterator im=materials.begin(); im!=materials.end(); ++im)
+			{
+				result.materials[im->first] = im->second;
+			}
 		}
 		else if(type == "g")
 		{
@@ -371,15 +594,24 @@ void loadObj(const std::string& filename, Mesh& result)
 			{
 				throw std::runtime_error("material without a group encountered");
 			}
-			if (!result.components.back().materialName.empty())
+			if (result.components.back().materialId != 0)
 			{
 				std::cerr << "component " << result.components.back().componentName << " already has a material, replacing the old definition";
 			}
-			stream >> result.components.back().materialName;
+			stream >> materialName;
+			std::map<std::string, int>::iterator it = materialIds.find(materialName);
+			if (it == materialIds.end())
+			{
+				it = materialIds.insert(std::make_pair(materialName, (int) result.materialNames.size())).first;
+				result.materialNames.push_back(materialName);
+			}
+			result.components.back().materialId = it->second;
 		}
 		else if(type == "s")
 		{
-			// FIXME: Smooth shading
+			std::string group;
+			stream >> group;
+			smoothingGroup = group == "off" ? 0 : atoi(group.c_str());
 		}
 		else if(type == "o")
 		{
@@ -399,8 +631,8 @@ void loadObj(const std::string& filename, Mesh& result)
 			stream >> vn.data[0] >> vn.data[1] >> vn.data[2];
 			if (normalizeNormals)
 			{
-				float normalLength = vn.data[0]*vn.data[0] + vn.data[1]*vn.data[1] + vn.data[2]*vn.data[2];
-				if (abs(1.0f-normalLength) > 1e-3f && normalLength > 1e-3f)
+				float normalLength = sqrt(vn.data[0]*vn.data[0] + vn.data[1]*vn.data[1] + vn.data[2]*vn.data[2]);
+				if (std::fabs(1.0f-normalLength) > 1e-3f && normalLength > 1e-3f)
 				{
 					vn.data[0] /= normalLength;
 					vn.data[1] /= normalLength;
@@ -427,15 +659,27 @@ void loadObj(const std::string& filename, Mesh& result)
 			const char* ptr = line.c_str() + pos;
 
 			// Every vertex may supply up to 3 indexes (vertex index, normal index, texcoord index)
-			Vector3i loadedIndices[3];
-			int mappedIndices[3];
-			int vertexCount;
-
-			if(parseFace(ptr, loadedIndices, vertexCount, 3))
+			if(parseFace(ptr, loadedIndices, (int) vertices.size(), (int) normals.size(), (int) texcoord.size()))
 			{
+				int vertexCount = (int) loadedIndices.size();
+				if (vertexCount < 3)
+				{
+					throw std::runtime_error("OBJ loader: face with less than 3 vertices encountered");
+				}
+
+				mappedIndices.resize(vertexCount);
+				polygon.resize(vertexCount);
+
 				// If the face is legal, for every vertex, assign the normal and the texcoord
 				for (int i = 0; i < vertexCount; ++i)
 				{
+					int vertexIndex = loadedIndices[i].data[0] - 1;
+					if (vertexIndex < 0 || vertexIndex >= (int) vertices.size())
+					{
+						throw std::runtime_error("Unknown vertex specified");
+					}
+					polygon[i] = vertices[vertexIndex];
+
 					if (uniqueVertexMap.find(loadedIndices[i]) != uniqueVertexMap.end())
 					{
 						mappedIndices[i] = uniqueVertexMap[loadedIndices[i]];
@@ -445,21 +689,14 @@ void loadObj(const std::string& filename, Mesh& result)
 						mappedIndices[i] = (int) result.vertices.size();
 						uniqueVertexMap.insert(std::make_pair(loadedIndices[i], (int) uniqueVertexMap.size()));
 
-						int vertexIndex = loadedIndices[i].data[0] - 1;
-						if (vertexIndex < (int) vertices.size())
-						{
-							result.vertices.push_back(vertices[vertexIndex]);	
-						}
-						else
-						{
-							throw std::runtime_error("Unknown vertex specified");
-						}
+						result.vertices.push_back(vertices[vertexIndex]);
+						sourceVertices.push_back(vertexIndex);
 
 						if (hasNormals)
 						{
 							int normalIndex = loadedIndices[i].data[1] - 1;
 
-							if (normalIndex < (int) normals.size())
+							if (normalIndex >= 0 && normalIndex < (int) normals.size())
 							{
 								result.normals.push_back(normals[normalIndex]);	
 							}
@@ -474,7 +711,7 @@ void loadObj(const std::string& filename, Mesh& result)
 						{
 							int texCoordIndex = loadedIndices[i].data[2] - 1;
 							
-							if (texCoordIndex < (int) texcoord.size())
+							if (texCoordIndex >= 0 && texCoordIndex < (int) texcoord.size())
 							{
 								result.texcoord.push_back(texcoord[texCoordIndex]);	
 							}
@@ -486,24 +723,34 @@ void loadObj(const std::string& filename, Mesh& result)
 					}
 				}
 
-				if (vertexCount == 3)
+				if (result.components.size()==0)
 				{
-					if (result.components.size()==0)
-					{
-						result.components.push_back(MeshComponent());
-						result.components.back().componentName = "[default]";
-					}
-
-					Vector3i tri(mappedIndices);
-					result.components.back().faces.push_back(tri);
+					result.components.push_back(MeshComponent());
+					result.components.back().componentName = "[default]";
 				}
-				else if (vertexCount == 4)
+
+				// Quads and larger polygons are split into triangles
+				if (vertexCount == 3)
 				{
-					throw std::runtime_error("OBJ loader: quads are not supported, convert them to triangles");
+					triangles.resize(3);
+					triangles[0] = 0;
+					triangles[1] = 1;
+					triangles[2] = 2;
 				}
 				else
 				{
-					throw std::runtime_error("OBJ loader: face with strange number of vertices encountered");
+					triangulatePolygon(polygon, triangles);
+				}
+
+				std::vector<Vector3i>& faces = result.components.back().faces;
+				for (size_t t = 0; t+2 < triangles.size(); t += 3)
+				{
+					Vector3i tri;
+					tri.data[0] = mappedIndices[triangles[t]];
+					tri.data[1] = mappedIndices[triangles[t+1]];
+					tri.data[2] = mappedIndices[triangles[t+2]];
+					faces.push_back(tri);
+					smoothingGroups.push_back(smoothingGroup);
 				}
 			}
 			else
@@ -524,7 +771,7 @@ void loadObj(const std::string& filename, Mesh& result)
 
 	if (!hasNormals)
 	{
-		throw std::runtime_error("OBJ loader: mesh without normals");
+		generateNormals(result, sourceVertices, smoothingGroups, creaseAngle);
 	}
 
 	if (result.texcoord.size()==0)
@@ -546,7 +793,7 @@ void loadObj(const std::string& filename, Mesh& result)
 }
 
 template<class T>
-void writeVector(std::ofstream& outfile, const std::string& type, const T& v)
+void writeVector(std::ostream& outfile, const std::string& type, const T& v)
 {
 	outfile << type << " ";
 	for(int i=0; i<T::Dimension-1; i++)
@@ -557,7 +804,7 @@ void writeVector(std::ofstream& outfile, const std::string& type, const T& v)
 	outfile << std::endl;
 }
 
-void writeVertexIndex(std::ofstream& outfile, int index, bool hasNormals, bool hasTexCoord)
+void writeVertexIndex(std::ostream& outfile, int index, bool hasNormals, bool hasTexCoord)
 {
 	index++;
 	if(hasNormals && hasTexCoord)
@@ -574,7 +821,7 @@ void writeVertexIndex(std::ofstream& outfile, int index, bool hasNormals, bool h
 	}
 }
 
-void writeMaterialTexture(std::ofstream& outfile, const std::string& type, const std::string& textureFilename)
+void writeMaterialTexture(std::ostream& outfile, const std::string& type, const std::string& textureFilename)
 {
 	if (!textureFilename.empty())
 	{
@@ -582,7 +829,45 @@ void writeMaterialTexture(std::ofstream& outfile, const std::string& type, const
 	}
 }
 
-void writeObj(const std::string& filename, const std::string matFilename, const Mesh& mesh)
+void writeMaterialFile(const std::string& filename, const MaterialMapType& materials)
+{
+	std::ofstream matfile;
+	matfile.open(filename.c_str());
+	if(!matfile.is_open())
+	{
+		throw std::runtime_error("Unable to open output material file: " + filename);
+	}
+	writeMaterialFile(matfile, materials);
+	matfile.close();
+}
+
+void writeMaterialFile(std::ostream& matfile, const MaterialMapType& materials)
+{
+	for(MaterialMapType::const_iterator im=materials.begin(); im!=materials.end(); ++im)
+	{
+		const std::string& name = im->first;
+		const Material& mat = im->second;
+
+		matfile << "#material" << std::endl;
+		matfile << "newmtl " << name << std::endl;
+		matfile << "illum " << mat.illuminationModel << std::endl;
+		writeVector(matfile, "Ka", mat.colorAmbient);
+		writeVector(matfile, "Kd", mat.colorDiffuse);
+		writeVector(matfile, "Ks", mat.colorSpecular);
+		writeVector(matfile, "Ke", mat.colorEmissive);
+		matfile << "Ns " << mat.shininess << std::endl;
+		matfile << "d " << mat.transparency << std::endl;
+		writeMaterialTexture(matfile, "map_Ka",   mat.textureAmbient);
+		writeMaterialTexture(matfile, "map_Kd",   mat.textureDiffuse);
+		writeMaterialTexture(matfile, "map_Ks",   mat.textureSpecular);
+		writeMaterialTexture(matfile, "map_Ke",   mat.textureEmissive);
+		writeMaterialTexture(matfile, "map_bump", mat.textureBump);
+		writeMaterialTexture(matfile, "map_d",    mat.textureTransparency);
+		matfile << std::endl;
+	}
+}
+
+void writeObj(const std::string& filename, const std::string matFilename, const Mesh& mesh, bool writeMaterials)
 {
 	// Open the file
 	std::ofstream outfile;
@@ -591,7 +876,18 @@ void writeObj(const std::string& filename, const std::string matFilename, const
 	{
 		throw std::runtime_error("Unable to open output mesh file: " + filename);
 	}
+	writeObj(outfile, matFilename, mesh);
+	outfile.close();
+
+	// Write materials
+	if (writeMaterials)
+	{
+		writeMaterialFile(matFilename, mesh.materials);
+	}
+}
 
+void writeObj(std::ostream& outfile, const std::string& matFilename, const Mesh& mesh)
+{
 	bool hasVertices = true;
 	if(mesh.vertices.size()==0)
 	{
@@ -663,9 +959,9 @@ void writeObj(const std::string& filename, const std::string matFilename, const
 		// Component name
 		outfile << "g " << comp.componentName << std::endl;
 		// Component material
-		if(!comp.materialName.empty())
+		if(comp.materialId != 0)
 		{
-			outfile << "usemtl " << comp.materialName << std::endl;
+			outfile << "usemtl " << mesh.materialNames[comp.materialId] << std::endl;
 		}
 		outfile << "s " << 1 << std::endl;
 		// Faces
@@ -680,36 +976,4 @@ void writeObj(const std::string& filename, const std::string matFilename, const
 			outfile << std::endl;
 		}
 	}
-	outfile.close();
-
-	// Write materials
-	std::ofstream matfile;
-	matfile.open(matFilename.c_str());
-	if(!matfile.is_open())
-	{
-		throw std::runtime_error("Unable to open output material file: " + matFilename);
-	}
-	for(MaterialMapType::const_iterator im=mesh.materials.begin(); im!=mesh.materials.end(); ++im)
-	{
-		const std::string& name = im->first;
-		const Material& mat = im->second;
-
-		matfile << "#material" << std::endl;
-		matfile << "newmtl " << name << std::endl;
-		matfile << "illum " << mat.illuminationModel << std::endl;
-		writeVector(matfile, "Ka", mat.colorAmbient);
-		writeVector(matfile, "Kd", mat.colorDiffuse);
-		writeVector(matfile, "Ks", mat.colorSpecular);
-		writeVector(matfile, "Ke", mat.colorEmissive);
-		matfile << "Ns " << mat.shininess << std::endl;
-		matfile << "d " << mat.transparency << std::endl;
-		writeMaterialTexture(matfile, "map_Ka",   mat.textureAmbient);
-		writeMaterialTexture(matfile, "map_Kd",   mat.textureDiffuse);
-		writeMaterialTexture(matfile, "map_Ks",   mat.textureSpecular);
-		writeMaterialTexture(matfile, "map_Ke",   mat.textureEmissive);
-		writeMaterialTexture(matfile, "map_bump", mat.textureBump);
-		writeMaterialTexture(matfile, "map_d",    mat.textureTransparency);
-		matfile << std::endl;
-	}
-	matfile.close();
 }
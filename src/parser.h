@@ -1,4 +1,30 @@
+#ifndef PARSER_H
+#define PARSER_H
+
 #include "objTypes.h"
+#include "resolver.h"
+
+#include <boost/function.hpp>
+
+//! Called by the obj loader with the materials of each material library, as soon as it is loaded
+typedef boost::function<void (const MaterialMapType&)> MaterialsLoadedCallback;
+
+//! Default crease angle in degrees, faces meeting at a sharper angle are not smoothed when normals are generated
+const float defaultCreaseAngle = 60.0f;
+
+bool parseFace(const char*& str, std::vector<Vector3i>& indices, int vertexCount, int normalCount, int texcoordCount);
+void loadMaterialFile(const std::string& filename, MaterialMapType& materials);
+//! Loads a material library from a stream, texture names are resolved relative to the library's filename
+void loadMaterialFile(std::istream& infile, const std::string& filename, MaterialMapType& materials);
+//! Loads an obj file, generating smooth normals from the smoothing groups if it has none
+void loadObj(const std::string& filename, Mesh& result, const MaterialsLoadedCallback& materialsLoaded = MaterialsLoadedCallback(), float creaseAngle = defaultCreaseAngle);
+//! Loads an obj file from a stream, material libraries are opened with the resolver
+//! Material library and texture names are resolved relative to the obj's filename.
+void loadObj(std::istream& infile, const std::string& filename, FileResolver& resolver, Mesh& result, const MaterialsLoadedCallback& materialsLoaded = MaterialsLoadedCallback(), float creaseAngle = defaultCreaseAngle);
+void writeMaterialFile(const std::string& filename, const MaterialMapType& materials);
+void writeMaterialFile(std::ostream& outfile, const MaterialMapType& materials);
+void writeObj(const std::string& filename, const std::string matFilename, const Mesh& mesh, bool writeMaterials = true);
+//! Writes an obj file to a stream, without its material file
+void writeObj(std::ostream& outfile, const std::string& matFilename, const Mesh& mesh);
 
-void loadObj(const std::string& filename, Mesh& result);
-void writeObj(const std::string& filename, const std::string matFilename, const Mesh& mesh);
+#endif
@@ -0,0 +1,518 @@
+#include "pipeline.h"
+#include "parser.h"
+#include "packer.h"
+#include "taskQueue.h"
+#include "simplifier.h"
+#include "binaryWriter.h"
+#include "chunker.h"
+#include "bakeLayout.h"
+#include "welder.h"
+#include "virtualTexture.h"
+#include "textureArray.h"
+#include "tangents.h"
+
+#include <boost/bind.hpp>
+#include <algorithm>
+#include <set>
+#include <sstream>
+#include <fstream>
+#include <iostream>
+
+//=================================================================================================
+// Queues the decoding of the textures of a freshly loaded material library
+//=================================================================================================
+void queueTextureDecoding(TaskQueue& imageTasks, AtlasBuilder& atlas, const MaterialMapType& materials)
+{
+	imageTasks.post(boost::bind(&AtlasBuilder::loadTextures, &atlas, materials));
+}
+
+//=================================================================================================
+// Writes a mesh as obj or binary file
+//=================================================================================================
+void writeMesh(const BakeOptions& options, const std::string& filename, const std::string& matFilename, const Mesh& mesh, bool writeMaterials)
+{
+	if (!options.binary)
+	{
+		writeObj(filename, matFilename, mesh, writeMaterials);
+		return;
+	}
+
+	BinaryLayout layout;
+	layout.quantize = options.quantize;
+	layout.normalBits = options.normalBits;
+	layout.meshlets = options.meshlets;
+	layout.chunks = options.chunks;
+	layout.tangents = options.tangents;
+	writeBinaryMesh(filename, matFilename, mesh, layout);
+	if (writeMaterials)
+	{
+		writeMaterialFile(matFilename, mesh.materials);
+	}
+}
+
+//=================================================================================================
+// Splits the extension off a filename, the extension keeps its dot
+//=================================================================================================
+void splitExtension(const std::string& filename, std::string& baseFilename, std::string& extension)
+{
+	baseFilename = filename;
+	extension.clear();
+	size_t dot = filename.find_last_of('.');
+	if (dot != std::string::npos && filename.find_first_of("/\\", dot) == std::string::npos)
+	{
+		baseFilename = filename.substr(0, dot);
+		extension = filename.substr(dot);
+	}
+}
+
+//=================================================================================================
+// Welds duplicate vertices and reports what was merged, meshes without duplicates are not mentioned
+//=================================================================================================
+void weldMesh(Mesh& mesh)
+{
+	WeldStatistics statistics = weldVertices(mesh);
+	if (statistics.weldedCount > 0)
+	{
+		std::cerr << "welded " << statistics.weldedCount << " of " << statistics.vertexCount << " vertices";
+		if (statistics.removedFaces > 0)
+		{
+			std::cerr << ", removed " << statistics.removedFaces << " collapsed faces";
+		}
+		std::cerr << std::endl;
+	}
+}
+
+//=================================================================================================
+// Splits the vertices for tangents and the faces into chunks, just before a mesh is written
+//=================================================================================================
+void splitMesh(const BakeOptions& options, Mesh& mesh)
+{
+	if (options.tangents)
+	{
+		int splitCount = splitMirroredVertices(mesh);
+		if (splitCount > 0)
+		{
+			std::cerr << "split " << splitCount << " vertices at mirrored texture coordinates" << std::endl;
+		}
+	}
+	if (options.chunks)
+	{
+		splitIntoChunks(mesh, maxChunkVertices);
+	}
+}
+
+//=================================================================================================
+// Splits a simplified level into chunks and writes it next to the baked mesh
+//=================================================================================================
+void writeLevelOfDetail(const BakeOptions& options, Mesh& lod, int level, const std::string& outputFilename, const std::string& matFilename)
+{
+	std::string baseFilename;
+	std::string extension;
+	splitExtension(outputFilename, baseFilename, extension);
+	splitMesh(options, lod);
+
+	std::ostringstream filename;
+	filename << baseFilename << ".lod" << level << extension;
+	writeMesh(options, filename.str(), matFilename, lod, false);
+}
+
+//=================================================================================================
+// Writes levels of detail next to the baked mesh, each one with half the faces of the previous one
+// Each level is simplified from the previous one before that is split into chunks.
+//=================================================================================================
+void writeLevelsOfDetail(const BakeOptions& options, const Mesh& mesh, const std::string& outputFilename, const std::string& matFilename)
+{
+	Mesh levels[2];
+	for(int level=1; level<=options.lodCount; ++level)
+	{
+		const Mesh& previous = level > 1 ? levels[(level-1)%2] : mesh;
+		Mesh& lod = levels[level%2];
+		simplifyMesh(previous, countFaces(previous)/2, lod);
+		if (level > 1)
+		{
+			writeLevelOfDetail(options, levels[(level-1)%2], level-1, outputFilename, matFilename);
+		}
+	}
+	if (options.lodCount > 0)
+	{
+		writeLevelOfDetail(options, levels[options.lodCount%2], options.lodCount, outputFilename, matFilename);
+	}
+}
+
+//=================================================================================================
+// Writes a baked mesh and its levels of detail
+// The levels are simplified from the whole mesh, before it is split into chunks.
+//=================================================================================================
+void writeBakedMesh(const BakeOptions& options, Mesh& mesh, const std::string& outputFilename, const std::string& matFilename, bool writeMaterials)
+{
+	writeLevelsOfDetail(options, mesh, outputFilename, matFilename);
+	splitMesh(options, mesh);
+	writeMesh(options, outputFilename, matFilename, mesh, writeMaterials);
+}
+
+//=================================================================================================
+// Saves the packed atlas as one image, or as virtual texture pages listed in a page table
+// The material refers to the page table, the pages are written next to it.
+//=================================================================================================
+void saveAtlas(const BakeOptions& options, AtlasBuilder& atlas, const std::string& textureFilename)
+{
+	if (options.pageSize <= 0)
+	{
+		atlas.save(textureFilename);
+		return;
+	}
+
+	std::string baseFilename;
+	std::string extension;
+	splitExtension(textureFilename, baseFilename, extension);
+	saveVirtualTexture(atlas, textureFilename, baseFilename, options.pageSize, virtualPageBorder);
+}
+
+//=================================================================================================
+// Name of a material of one of several meshes packed into one atlas
+//=================================================================================================
+std::string sharedMaterialName(size_t meshIndex, const std::string& name)
+{
+	std::ostringstream result;
+	result << meshIndex << ":" << name;
+	return result.str();
+}
+
+//=================================================================================================
+// Prefix of the blended materials of a mesh in a shared bake, after the name of its output file
+//=================================================================================================
+std::string blendedMaterialPrefix(const std::string& outputFilename)
+{
+	std::string baseFilename;
+	std::string extension;
+	splitExtension(outputFilename, baseFilename, extension);
+	size_t slash = baseFilename.find_last_of("/\\");
+	std::string result = slash != std::string::npos ? baseFilename.substr(slash+1) : baseFilename;
+	std::replace(result.begin(), result.end(), ' ', '_');
+	return result + "_";
+}
+
+//=================================================================================================
+// Input, outputs and the options that change them, a layout only applies to a bake with the same settings
+//=================================================================================================
+std::string bakeSettings(const BakeOptions& options, const std::string& inputFilename, const std::string& outputFilename, const std::string& matFilename, const std::string& textureFilename)
+{
+	std::ostringstream result;
+	result << "atlas-size " << options.maxAtlasSize << " lods " << options.lodCount
+		<< " binary " << options.binary << " quantize " << options.quantize << " normal-bits " << options.normalBits
+		<< " meshlets " << options.meshlets << " chunks " << options.chunks << " tangents " << options.tangents << " crease-angle " << options.creaseAngle << " weld " << options.weld << " alpha-texels " << options.alphaTexels
+		<< " input " << inputFilename << " output " << outputFilename << " material " << matFilename << " texture " << textureFilename;
+	return result.str();
+}
+
+//=================================================================================================
+// Updates the atlas of a previous bake in place if only the contents of textures changed
+// The mesh and material files are kept. Returns false if the obj file has to be baked again.
+//=================================================================================================
+bool updateBakedAtlas(const std::string& layoutFilename, const std::string& settings, const std::string& outputFilename, const std::string& matFilename, const std::string& textureFilename, const PngOptions& pngOptions)
+{
+	BakeLayout layout;
+	if (!readBakeLayout(layoutFilename, layout) || layout.settings != settings ||
+		!std::ifstream(outputFilename.c_str()) || !std::ifstream(matFilename.c_str()))
+	{
+		return false;
+	}
+
+	unsigned long long hash;
+	for(size_t i=0; i<layout.sources.size(); ++i)
+	{
+		if (!hashFile(layout.sources[i].filename, hash) || hash != layout.sources[i].hash)
+		{
+			return false;
+		}
+	}
+
+	std::vector<size_t> changedTiles;
+	for(size_t i=0; i<layout.atlas.tiles.size(); ++i)
+	{
+		AtlasTile& tile = layout.atlas.tiles[i];
+		unsigned long long opacityHash = 0;
+		if (!hashFile(tile.filename, hash) || (!tile.opacityFilename.empty() && !hashFile(tile.opacityFilename, opacityHash)))
+		{
+			return false;
+		}
+		if (hash != tile.hash || opacityHash != tile.opacityHash)
+		{
+			tile.hash = hash;
+			tile.opacityHash = opacityHash;
+			changedTiles.push_back(i);
+		}
+	}
+
+	if (!changedTiles.empty())
+	{
+		AtlasBuilder atlas;
+		atlas.setPngOptions(pngOptions);
+		bool success = false;
+		atlas.updateTiles(textureFilename, layout.atlas, changedTiles, success);
+		if (!success)
+		{
+			return false;
+		}
+		writeBakeLayout(layoutFilename, layout);
+	}
+	std::cerr << "updated " << changedTiles.size() << " of " << layout.atlas.tiles.size() << " textures in the atlas" << std::endl;
+	return true;
+}
+
+//=================================================================================================
+// Records the hashes of the inputs and the placement of the textures of a finished bake
+//=================================================================================================
+void writeLayoutSidecar(const std::string& layoutFilename, const std::string& settings, const std::vector<std::string>& sourceFilenames, const AtlasPlacement& placement)
+{
+	BakeLayout layout;
+	layout.settings = settings;
+	layout.atlas = placement;
+	for(size_t i=0; i<sourceFilenames.size(); ++i)
+	{
+		SourceFile source;
+		source.filename = sourceFilenames[i];
+		if (!hashFile(source.filename, source.hash))
+		{
+			throw std::runtime_error("Unable to hash " + source.filename);
+		}
+		layout.sources.push_back(source);
+	}
+	for(size_t i=0; i<layout.atlas.tiles.size(); ++i)
+	{
+		AtlasTile& tile = layout.atlas.tiles[i];
+		if (!hashFile(tile.filename, tile.hash))
+		{
+			throw std::runtime_error("Unable to hash " + tile.filename);
+		}
+		if (!tile.opacityFilename.empty() && !hashFile(tile.opacityFilename, tile.opacityHash))
+		{
+			throw std::runtime_error("Unable to hash " + tile.opacityFilename);
+		}
+	}
+	writeBakeLayout(layoutFilename, layout);
+}
+
+//=================================================================================================
+// Writes the used textures as texture arrays and bakes a mesh whose materials sample their layers
+// The arrays are saved while the mesh is written, the index is written once both are done.
+//=================================================================================================
+void bakeTextureArrays(const BakeOptions& options, TaskQueue& imageTasks, AtlasBuilder& atlas, Mesh& mesh, const MaterialUsageListType& usedMaterials, AlphaModeListType& alphaModes, const std::string& outputFilename, const std::string& matFilename, const std::string& indexFilename)
+{
+	std::string baseFilename;
+	std::string extension;
+	splitExtension(indexFilename, baseFilename, extension);
+
+	TextureArrayLayout arrays;
+	imageTasks.post(boost::bind(&buildTextureArrays, boost::ref(atlas), boost::cref(mesh.materials), boost::cref(mesh.materialNames), boost::cref(usedMaterials), options.maxAtlasSize, baseFilename, boost::ref(arrays)));
+	imageTasks.post(boost::bind(&classifyArrayTexels, boost::ref(atlas), boost::cref(arrays), boost::ref(alphaModes), options.alphaTexels));
+	imageTasks.wait();
+
+	imageTasks.post(boost::bind(&saveTextureArrays, boost::ref(atlas), boost::cref(arrays), boost::cref(options.png)));
+	std::vector<TextureArrayMaterial> arrayMaterials;
+	bakeArrayMaterials(mesh, arrays, alphaModes, arrayMaterials);
+	writeBakedMesh(options, mesh, outputFilename, matFilename, true);
+	imageTasks.wait();
+	writeTextureArrayIndex(indexFilename, arrays, arrayMaterials);
+}
+
+//=================================================================================================
+// Bakes an obj file, overlapping image work with mesh work
+// All DevIL calls run on the image task queue, one after another.
+//=================================================================================================
+void bakeObjPipelined(const BakeOptions& options, const std::string& inputFilename, const std::string& outputFilename, const std::string& matFilename, const std::string& textureFilename)
+{
+	std::string layoutFilename;
+	std::string extension;
+	splitExtension(outputFilename, layoutFilename, extension);
+	layoutFilename += ".layout";
+	std::string settings = bakeSettings(options, inputFilename, outputFilename, matFilename, textureFilename);
+	bool incremental = options.incremental && options.pageSize <= 0 && !options.textureArrays;
+	if (incremental && updateBakedAtlas(layoutFilename, settings, outputFilename, matFilename, textureFilename, options.png))
+	{
+		return;
+	}
+
+	AtlasBuilder atlas;
+	TaskQueue imageTasks;
+	Mesh mesh;
+	atlas.setMaxSize(options.maxAtlasSize);
+	atlas.setPngOptions(options.png);
+
+	// Parse the mesh, decoding the textures as soon as their material library is known
+	// The opened files are recorded as the sources of an incremental bake
+	DiskFileResolver diskResolver;
+	RecordingFileResolver resolver(diskResolver);
+	boost::shared_ptr<std::istream> infile = resolver.open(inputFilename);
+	if (!infile)
+	{
+		throw std::runtime_error("Unable to open mesh file: " + inputFilename);
+	}
+	loadObj(*infile, inputFilename, resolver, mesh, boost::bind(&queueTextureDecoding, boost::ref(imageTasks), boost::ref(atlas), _1), options.creaseAngle);
+	infile.reset();
+	if (options.weld)
+	{
+		weldMesh(mesh);
+	}
+
+	// Pack the atlas once all used materials are known
+	normalizeTexcoordRepeats(mesh);
+	MaterialUsageListType usedMaterials;
+	collectUsedMaterials(mesh, usedMaterials);
+	AlphaModeListType alphaModes;
+	classifyMaterials(mesh, alphaModes);
+	if (options.textureArrays)
+	{
+		bakeTextureArrays(options, imageTasks, atlas, mesh, usedMaterials, alphaModes, outputFilename, matFilename, textureFilename);
+		return;
+	}
+	AtlasLayoutType layout;
+	imageTasks.post(boost::bind(&AtlasBuilder::pack, &atlas, boost::cref(mesh.materials), boost::cref(mesh.materialNames), boost::cref(usedMaterials), boost::ref(layout)));
+	imageTasks.post(boost::bind(&AtlasBuilder::classifyTexels, &atlas, boost::ref(alphaModes), options.alphaTexels));
+	imageTasks.wait();
+	AtlasPlacement placement;
+	atlas.getPlacement(placement);
+
+	// Transform the texture coordinates, then write the mesh while the atlas is stitched and saved
+	imageTasks.post(boost::bind(&saveAtlas, boost::cref(options), boost::ref(atlas), textureFilename));
+	bakeTexcoords(mesh, layout, alphaModes, textureFilename);
+	writeBakedMesh(options, mesh, outputFilename, matFilename, true);
+	imageTasks.wait();
+
+	if (incremental)
+	{
+		writeLayoutSidecar(layoutFilename, settings, resolver.getFilenames(), placement);
+	}
+}
+
+//=================================================================================================
+// Bakes several obj files into one shared atlas
+// Material names are prefixed with the index of their mesh while packing, so equally named
+// materials of different meshes may use different textures. Textures used by several meshes are packed once.
+// The material ids of each mesh map to a consecutive range of shared ids.
+//=================================================================================================
+void bakeObjsSharedAtlas(const BakeOptions& options, const std::vector<std::string>& inputFilenames, const std::vector<std::string>& outputFilenames, const std::string& matFilename, const std::string& textureFilename)
+{
+	AtlasBuilder atlas;
+	TaskQueue imageTasks;
+	std::vector<Mesh> meshes(inputFilenames.size());
+	atlas.setMaxSize(options.maxAtlasSize);
+	atlas.setPngOptions(options.png);
+
+	// Parse all meshes and collect their used materials under unique names
+	MaterialMapType sharedMaterials;
+	std::vector<std::string> sharedMaterialNames(1);
+	MaterialUsageListType sharedUsedMaterials(1);
+	AlphaModeListType sharedAlphaModes(1, alphaOpaque);
+	std::vector<size_t> sharedIdOffsets(meshes.size());
+	for(size_t i=0; i<meshes.size(); ++i)
+	{
+		Mesh& mesh = meshes[i];
+		loadObj(inputFilenames[i], mesh, boost::bind(&queueTextureDecoding, boost::ref(imageTasks), boost::ref(atlas), _1), options.creaseAngle);
+		if (options.weld)
+		{
+			weldMesh(mesh);
+		}
+		normalizeTexcoordRepeats(mesh);
+		MaterialUsageListType usedMaterials;
+		collectUsedMaterials(mesh, usedMaterials);
+		AlphaModeListType alphaModes;
+		classifyMaterials(mesh, alphaModes);
+
+		for(MaterialMapType::const_iterator im=mesh.materials.begin(); im!=mesh.materials.end(); ++im)
+		{
+			sharedMaterials[sharedMaterialName(i, im->first)] = im->second;
+		}
+		sharedIdOffsets[i] = sharedMaterialNames.size() - 1;
+		for(size_t id=1; id<mesh.materialNames.size(); ++id)
+		{
+			sharedMaterialNames.push_back(sharedMaterialName(i, mesh.materialNames[id]));
+			sharedUsedMaterials.push_back(usedMaterials[id]);
+			sharedAlphaModes.push_back(alphaModes[id]);
+		}
+	}
+
+	// Pack the shared atlas, or bucket the textures of all meshes into shared texture arrays
+	AtlasLayoutType sharedLayout;
+	TextureArrayLayout sharedArrays;
+	std::string baseFilename;
+	std::string extension;
+	splitExtension(textureFilename, baseFilename, extension);
+	if (options.textureArrays)
+	{
+		imageTasks.post(boost::bind(&buildTextureArrays, boost::ref(atlas), boost::cref(sharedMaterials), boost::cref(sharedMaterialNames), boost::cref(sharedUsedMaterials), options.maxAtlasSize, baseFilename, boost::ref(sharedArrays)));
+		imageTasks.post(boost::bind(&classifyArrayTexels, boost::ref(atlas), boost::cref(sharedArrays), boost::ref(sharedAlphaModes), options.alphaTexels));
+	}
+	else
+	{
+		imageTasks.post(boost::bind(&AtlasBuilder::pack, &atlas, boost::cref(sharedMaterials), boost::cref(sharedMaterialNames), boost::cref(sharedUsedMaterials), boost::ref(sharedLayout)));
+		imageTasks.post(boost::bind(&AtlasBuilder::classifyTexels, &atlas, boost::ref(sharedAlphaModes), options.alphaTexels));
+	}
+	imageTasks.wait();
+
+	// Transform and write each mesh against the shared layout while the atlas is saved
+	// Meshes may bake into different alpha modes, the material file lists the materials of all of them
+	// Blended materials carry the transparency of their faces and are named after their mesh
+	if (options.textureArrays)
+	{
+		imageTasks.post(boost::bind(&saveTextureArrays, boost::ref(atlas), boost::cref(sharedArrays), boost::cref(options.png)));
+	}
+	else
+	{
+		imageTasks.post(boost::bind(&saveAtlas, boost::cref(options), boost::ref(atlas), textureFilename));
+	}
+	MaterialMapType bakedMaterials;
+	std::vector<TextureArrayMaterial> arrayMaterials;
+	for(size_t i=0; i<meshes.size(); ++i)
+	{
+		Mesh& mesh = meshes[i];
+		AlphaModeListType alphaModes(mesh.materialNames.size(), alphaOpaque);
+		for(size_t id=1; id<alphaModes.size(); ++id)
+		{
+			alphaModes[id] = sharedAlphaModes[sharedIdOffsets[i] + id];
+		}
+
+		if (options.textureArrays)
+		{
+			TextureArrayLayout arrays;
+			arrays.arrays = sharedArrays.arrays;
+			arrays.materialArrays.assign(mesh.materialNames.size(), -1);
+			arrays.materialLayers.assign(mesh.materialNames.size(), -1);
+			for(size_t id=1; id<mesh.materialNames.size(); ++id)
+			{
+				arrays.materialArrays[id] = sharedArrays.materialArrays[sharedIdOffsets[i] + id];
+				arrays.materialLayers[id] = sharedArrays.materialLayers[sharedIdOffsets[i] + id];
+			}
+			bakeArrayMaterials(mesh, arrays, alphaModes, arrayMaterials, blendedMaterialPrefix(outputFilenames[i]));
+		}
+		else
+		{
+			AtlasLayoutType layout(mesh.materialNames.size());
+			for(size_t id=1; id<layout.size(); ++id)
+			{
+				layout[id] = sharedLayout[sharedIdOffsets[i] + id];
+			}
+			bakeTexcoords(mesh, layout, alphaModes, textureFilename, blendedMaterialPrefix(outputFilenames[i]));
+		}
+		writeBakedMesh(options, mesh, outputFilenames[i], matFilename, false);
+		bakedMaterials.insert(mesh.materials.begin(), mesh.materials.end());
+		mesh = Mesh();
+	}
+	writeMaterialFile(matFilename, bakedMaterials);
+	imageTasks.wait();
+
+	if (options.textureArrays)
+	{
+		// Materials are named after their layer, each one is listed once, blended ones once per mesh
+		std::vector<TextureArrayMaterial> uniqueMaterials;
+		std::set<std::string> names;
+		for(size_t i=0; i<arrayMaterials.size(); ++i)
+		{
+			if (names.insert(arrayMaterials[i].name).second)
+			{
+				uniqueMaterials.push_back(arrayMaterials[i]);
+			}
+		}
+		writeTextureArrayIndex(textureFilename, sharedArrays, uniqueMaterials);
+	}
+}
@@ -0,0 +1,17 @@
+#ifndef PIPELINE_H
+#define PIPELINE_H
+
+#include "objTypes.h"
+#include "bakeObj.h"
+
+//! Loads, bakes and writes an obj file with overlapping stages
+//! Textures are decoded while the mesh is parsed, the atlas is saved while the mesh is written.
+void bakeObjPipelined(const BakeOptions& options, const std::string& inputFilename, const std::string& outputFilename, const std::string& matFilename, const std::string& textureFilename);
+
+//! Welds the duplicate vertices of a loaded mesh and reports the merged vertices and collapsed faces
+void weldMesh(Mesh& mesh);
+
+//! Bakes several obj files into one shared atlas, all baked meshes reference the same material
+void bakeObjsSharedAtlas(const BakeOptions& options, const std::vector<std::string>& inputFilenames, const std::vector<std::string>& outputFilenames, const std::string& matFilename, const std::string& textureFilename);
+
+#endif
@@ -0,0 +1,286 @@
+#include "pngEncoder.h"
+
+#include <vector>
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <stdexcept>
+
+#include <zlib.h>
+#include <boost/date_time/posix_time/posix_time_types.hpp>
+
+// Uncompressed bytes per band, large enough that the dictionary and flush overhead does not matter
+const size_t pngBandBytes = 1 << 20;
+// Largest back-reference of deflate, the dictionary of a band is at most this long
+const size_t deflateWindowBytes = 32768;
+// Bytes per pixel
+const int pngPixelBytes = 4;
+
+//=================================================================================================
+// Paeth predictor of the png specification
+//=================================================================================================
+inline unsigned char paethPredictor(int a, int b, int c)
+{
+	int p = a + b - c;
+	int pa = abs(p - a);
+	int pb = abs(p - b);
+	int pc = abs(p - c);
+	if (pa <= pb && pa <= pc)
+	{
+		return (unsigned char) a;
+	}
+	return (unsigned char) (pb <= pc ? b : c);
+}
+
+//=================================================================================================
+// Filters one row with the given filter type, writes the type byte followed by the filtered bytes
+// The previous row is NULL for the first row of the image.
+//=================================================================================================
+void filterRow(const unsigned char* row, const unsigned char* previous, size_t length, int filter, unsigned char* result)
+{
+	result[0] = (unsigned char) filter;
+	unsigned char* out = result + 1;
+	for(size_t i=0; i<length; ++i)
+	{
+		int left = i >= pngPixelBytes ? row[i-pngPixelBytes] : 0;
+		int up = previous ? previous[i] : 0;
+		int upLeft = previous && i >= pngPixelBytes ? previous[i-pngPixelBytes] : 0;
+		switch(filter)
+		{
+		case pngFilterSub:     out[i] = (unsigned char) (row[i] - left); break;
+		case pngFilterUp:      out[i] = (unsigned char) (row[i] - up); break;
+		case pngFilterAverage: out[i] = (unsigned char) (row[i] - (left + up) / 2); break;
+		case pngFilterPaeth:   out[i] = (unsigned char) (row[i] - paethPredictor(left, up, upLeft)); break;
+		default:               out[i] = row[i]; break;
+		}
+	}
+}
+
+//=================================================================================================
+// Filters one row, trying every filter type if the filter is adaptive
+// The adaptive heuristic is the one of libpng: the smallest sum of the filtered bytes taken as signed values.
+//=================================================================================================
+void filterRow(const unsigned char* row, const unsigned char* previous, size_t length, PngFilter filter, std::vector<unsigned char>& scratch, unsigned char* result)
+{
+	if (filter != pngFilterAdaptive)
+	{
+		filterRow(row, previous, length, filter, result);
+		return;
+	}
+
+	scratch.resize(length+1);
+	unsigned long bestSum = 0;
+	for(int f=pngFilterNone; f<=pngFilterPaeth; ++f)
+	{
+		unsigned char* candidate = f == pngFilterNone ? result : &scratch[0];
+		filterRow(row, previous, length, f, candidate);
+		unsigned long sum = 0;
+		for(size_t i=1; i<=length; ++i)
+		{
+			sum += candidate[i] < 128 ? candidate[i] : 256 - candidate[i];
+		}
+		if (f == pngFilterNone || sum < bestSum)
+		{
+			bestSum = sum;
+			if (candidate != result)
+			{
+				std::copy(candidate, candidate+length+1, result);
+			}
+		}
+	}
+}
+
+//=================================================================================================
+// Compressed band of rows
+//=================================================================================================
+struct PngBand
+{
+	int                        firstRow;
+	int                        rowCount;
+	std::vector<unsigned char> chunk;    //!< Type and contents of the IDAT chunk holding the band
+	unsigned long              adler;    //!< Checksum of the filtered bytes
+	unsigned long              crc;      //!< Checksum of the chunk
+};
+
+//=================================================================================================
+// Filters and deflates a band, the filtered rows before it that fit into the window become its dictionary
+//=================================================================================================
+void compressBand(const unsigned char* pixels, int width, const PngOptions& options, bool lastBand, PngBand& band)
+{
+	size_t rowBytes = size_t(width) * pngPixelBytes;
+	size_t filteredRowBytes = rowBytes + 1;
+	int dictionaryRows = (int) std::min<size_t>(band.firstRow, (deflateWindowBytes + filteredRowBytes-1) / filteredRowBytes);
+	int firstRow = band.firstRow - dictionaryRows;
+	int rowCount = band.rowCount + dictionaryRows;
+
+	std::vector<unsigned char> filtered(filteredRowBytes * rowCount);
+	std::vector<unsigned char> scratch;
+	for(int r=0; r<rowCount; ++r)
+	{
+		int row = firstRow + r;
+		const unsigned char* previous = row > 0 ? pixels + (row-1)*rowBytes : NULL;
+		filterRow(pixels + row*rowBytes, previous, rowBytes, options.filter, scratch, &filtered[r*filteredRowBytes]);
+	}
+	size_t dictionaryBytes = std::min(deflateWindowBytes, dictionaryRows*filteredRowBytes);
+	const unsigned char* input = &filtered[dictionaryRows*filteredRowBytes];
+	size_t inputBytes = band.rowCount*filteredRowBytes;
+
+	z_stream stream;
+	stream.zalloc = Z_NULL;
+	stream.zfree = Z_NULL;
+	stream.opaque = Z_NULL;
+	int strategy = options.filter == pngFilterNone ? Z_DEFAULT_STRATEGY : Z_FILTERED;
+	if (deflateInit2(&stream, options.level, Z_DEFLATED, -15, 8, strategy) != Z_OK)
+	{
+		throw std::runtime_error("could not initialize the png compressor");
+	}
+	if (dictionaryBytes > 0)
+	{
+		deflateSetDictionary(&stream, input - dictionaryBytes, uInt(dictionaryBytes));
+	}
+
+	// Bands before the last one end with an empty stored block, so that the next band starts on a byte boundary
+	band.chunk.resize(4 + deflateBound(&stream, uLong(inputBytes)) + 16);
+	std::copy("IDAT", "IDAT"+4, band.chunk.begin());
+	stream.next_in = const_cast<unsigned char*>(input);
+	stream.avail_in = uInt(inputBytes);
+	stream.next_out = &band.chunk[4];
+	stream.avail_out = uInt(band.chunk.size() - 4);
+	int result = deflate(&stream, lastBand ? Z_FINISH : Z_SYNC_FLUSH);
+	band.chunk.resize(band.chunk.size() - stream.avail_out);
+	deflateEnd(&stream);
+	if (result != (lastBand ? Z_STREAM_END : Z_OK) || stream.avail_in != 0)
+	{
+		throw std::runtime_error("could not compress the png image");
+	}
+
+	band.adler = adler32(adler32(0L, Z_NULL, 0), input, uInt(inputBytes));
+	band.crc = crc32(crc32(0L, Z_NULL, 0), &band.chunk[0], uInt(band.chunk.size()));
+}
+
+//=================================================================================================
+// Appends a big endian 32-bit value
+//=================================================================================================
+void appendUint32(std::string& data, unsigned long value)
+{
+	data += (char) ((value >> 24) & 0xff);
+	data += (char) ((value >> 16) & 0xff);
+	data += (char) ((value >> 8) & 0xff);
+	data += (char) (value & 0xff);
+}
+
+//=================================================================================================
+// Appends a chunk whose crc is computed here
+//=================================================================================================
+void appendChunk(std::string& data, const char* type, const unsigned char* contents, size_t length)
+{
+	appendUint32(data, (unsigned long) length);
+	size_t start = data.size();
+	data.append(type, 4);
+	if (length > 0)
+	{
+		data.append((const char*) contents, length);
+	}
+	appendUint32(data, crc32(crc32(0L, Z_NULL, 0), (const unsigned char*) &data[start], uInt(length + 4)));
+}
+
+void encodePng(const unsigned char* pixels, int width, int height, const PngOptions& options, std::string& data)
+{
+	boost::posix_time::ptime start = boost::posix_time::microsec_clock::universal_time();
+	if (width <= 0 || height <= 0)
+	{
+		throw std::runtime_error("could not encode an empty png image");
+	}
+
+	size_t filteredRowBytes = size_t(width) * pngPixelBytes + 1;
+	int bandRows = (int) std::max<size_t>(1, pngBandBytes / filteredRowBytes);
+	std::vector<PngBand> bands((height + bandRows-1) / bandRows);
+	for(size_t b=0; b<bands.size(); ++b)
+	{
+		bands[b].firstRow = int(b) * bandRows;
+		bands[b].rowCount = std::min(bandRows, height - bands[b].firstRow);
+	}
+
+	// Exceptions must not leave the parallel loop, the first error is rethrown afterwards
+	std::string error;
+	#pragma omp parallel for schedule(dynamic, 1)
+	for(int b=0; b<(int) bands.size(); ++b)
+	{
+		try
+		{
+			compressBand(pixels, width, options, b+1 == (int) bands.size(), bands[b]);
+		}
+		catch(std::exception& e)
+		{
+			#pragma omp critical
+			error = e.what();
+		}
+	}
+	if (!error.empty())
+	{
+		throw std::runtime_error(error);
+	}
+
+	// Signature and header
+	const unsigned char signature[8] = {137, 'P', 'N', 'G', 13, 10, 26, 10};
+	data.assign((const char*) signature, 8);
+	unsigned char header[13] = {0, 0, 0, 0, 0, 0, 0, 0, 8, 6, 0, 0, 0};
+	for(int k=0; k<4; ++k)
+	{
+		header[k] = (unsigned char) ((width >> (24-8*k)) & 0xff);
+		header[4+k] = (unsigned char) ((height >> (24-8*k)) & 0xff);
+	}
+	appendChunk(data, "IHDR", header, sizeof(header));
+
+	// zlib header, one chunk per band and the checksum of the whole stream
+	int levelFlag = options.level < 2 ? 0 : (options.level < 6 ? 1 : (options.level == 6 ? 2 : 3));
+	unsigned char zlibHeader[2] = {0x78, (unsigned char) (levelFlag << 6)};
+	zlibHeader[1] = (unsigned char) (zlibHeader[1] + 31 - (zlibHeader[0]*256 + zlibHeader[1]) % 31);
+	appendChunk(data, "IDAT", zlibHeader, 2);
+
+	unsigned long adler = adler32(0L, Z_NULL, 0);
+	size_t rawBytes = 0;
+	for(size_t b=0; b<bands.size(); ++b)
+	{
+		const PngBand& band = bands[b];
+		size_t bandBytes = band.rowCount * filteredRowBytes;
+		adler = adler32_combine(adler, band.adler, z_off_t(bandBytes));
+		rawBytes += bandBytes;
+
+		appendUint32(data, (unsigned long) (band.chunk.size() - 4));
+		data.append((const char*) &band.chunk[0], band.chunk.size());
+		appendUint32(data, band.crc);
+	}
+
+	unsigned char checksum[4];
+	for(int k=0; k<4; ++k)
+	{
+		checksum[k] = (unsigned char) ((adler >> (24-8*k)) & 0xff);
+	}
+	appendChunk(data, "IDAT", checksum, 4);
+	appendChunk(data, "IEND", NULL, 0);
+
+	double seconds = (boost::posix_time::microsec_clock::universal_time() - start).total_microseconds() * 1e-6;
+	double megabytes = rawBytes / (1024.0*1024.0);
+	std::cerr << "encoded " << width << "x" << height << " png in " << bands.size() << " bands: "
+		<< megabytes << " MB to " << data.size() / (1024.0*1024.0) << " MB in " << seconds << " s";
+	if (seconds > 0.0)
+	{
+		std::cerr << " (" << megabytes / seconds << " MB/s)";
+	}
+	std::cerr << std::endl;
+}
+
+bool parsePngFilter(const std::string& name, PngFilter& filter)
+{
+	const char* names[] = {"none", "sub", "up", "average", "paeth", "adaptive"};
+	for(int f=pngFilterNone; f<=pngFilterAdaptive; ++f)
+	{
+		if (name == names[f])
+		{
+			filter = PngFilter(f);
+			return true;
+		}
+	}
+	return false;
+}
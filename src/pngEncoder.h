@@ -0,0 +1,39 @@
+#ifndef PNG_ENCODER_H
+#define PNG_ENCODER_H
+
+#include <string>
+
+//! Filters applied to the rows of a png image before compression
+enum PngFilter
+{
+	pngFilterNone = 0,
+	pngFilterSub,
+	pngFilterUp,
+	pngFilterAverage,
+	pngFilterPaeth,
+	pngFilterAdaptive //!< Pick the filter with the smallest sum of absolute differences for each row
+};
+
+//! Compression settings of png images
+struct PngOptions
+{
+	int       level;  //!< zlib compression level, 0 (store) to 9 (smallest)
+	PngFilter filter;
+
+	PngOptions()
+	{
+		level = 6;
+		filter = pngFilterAdaptive;
+	}
+};
+
+//! Encodes 32bit RGBA pixels with rows from the top as a png image, on all cores
+//! The rows are split into bands that are filtered and deflated independently, each band ending on a byte
+//! boundary and using the end of the band before it as dictionary. The bands are stitched into one zlib
+//! stream, so the result is a regular png. Prints the encoding throughput.
+void encodePng(const unsigned char* pixels, int width, int height, const PngOptions& options, std::string& data);
+
+//! Parses a filter name: none, sub, up, average, paeth or adaptive
+bool parsePngFilter(const std::string& name, PngFilter& filter);
+
+#endif
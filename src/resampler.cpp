@@ -0,0 +1,116 @@
+#include "resampler.h"
+
+#include <vector>
+#include <algorithm>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define BAKEOBJ_SSE2
+#include <emmintrin.h>
+#endif
+
+// ------------------------------------------------------------------------------
+// Source pixels covered by one target pixel along one axis
+// ------------------------------------------------------------------------------
+struct FilterTaps
+{
+	std::vector<int>   first;   //!< First source pixel of each target pixel
+	std::vector<int>   offsets; //!< Offset of the weights of each target pixel, plus one past the end
+	std::vector<float> weights; //!< Normalized weights of consecutive source pixels
+};
+
+// ------------------------------------------------------------------------------
+// Computes box filter taps for scaling sourceSize pixels to targetSize pixels
+// ------------------------------------------------------------------------------
+void computeTaps(int sourceSize, int targetSize, FilterTaps& taps)
+{
+	double scale = double(sourceSize) / double(targetSize);
+	taps.first.resize(targetSize);
+	taps.offsets.resize(targetSize+1);
+	taps.weights.clear();
+
+	for(int i=0; i<targetSize; ++i)
+	{
+		double begin = i*scale;
+		double end = std::min(double(sourceSize), (i+1)*scale);
+		int first = std::min(sourceSize-1, (int) floor(begin));
+		int last = std::max(first, std::min(sourceSize-1, (int) ceil(end)-1));
+
+		taps.first[i] = first;
+		taps.offsets[i] = (int) taps.weights.size();
+		for(int s=first; s<=last; ++s)
+		{
+			double coverage = std::min(end, double(s+1)) - std::max(begin, double(s));
+			taps.weights.push_back(float(std::max(coverage, 0.0) / (end-begin)));
+		}
+	}
+	taps.offsets[targetSize] = (int) taps.weights.size();
+}
+
+// ------------------------------------------------------------------------------
+// Accumulates weighted RGBA pixels, 4 channels at once where SSE2 is available
+// ------------------------------------------------------------------------------
+inline void accumulate(float* sum, const float* pixel, float weight)
+{
+#ifdef BAKEOBJ_SSE2
+	_mm_storeu_ps(sum, _mm_add_ps(_mm_loadu_ps(sum), _mm_mul_ps(_mm_loadu_ps(pixel), _mm_set1_ps(weight))));
+#else
+	for(int c=0; c<4; ++c)
+	{
+		sum[c] += pixel[c]*weight;
+	}
+#endif
+}
+
+void resampleImage(const unsigned char* source, int sourceWidth, int sourceHeight, unsigned char* target, int targetWidth, int targetHeight)
+{
+	FilterTaps tapsX, tapsY;
+	computeTaps(sourceWidth, targetWidth, tapsX);
+	computeTaps(sourceHeight, targetHeight, tapsY);
+
+	// Horizontal pass into a floating point image
+	std::vector<float> rows(4*size_t(targetWidth)*size_t(sourceHeight), 0.0f);
+
+	#pragma omp parallel for
+	for(int y=0; y<sourceHeight; ++y)
+	{
+		std::vector<float> line(4*sourceWidth);
+		const unsigned char* sourceRow = source + 4*size_t(sourceWidth)*y;
+		for(int i=0; i<4*sourceWidth; ++i)
+		{
+			line[i] = sourceRow[i];
+		}
+
+		float* targetRow = &rows[4*size_t(targetWidth)*y];
+		for(int x=0; x<targetWidth; ++x)
+		{
+			int first = tapsX.first[x];
+			for(int t=tapsX.offsets[x]; t<tapsX.offsets[x+1]; ++t)
+			{
+				accumulate(targetRow + 4*x, &line[4*(first + t - tapsX.offsets[x])], tapsX.weights[t]);
+			}
+		}
+	}
+
+	// Vertical pass into the target image
+	#pragma omp parallel for
+	for(int y=0; y<targetHeight; ++y)
+	{
+		std::vector<float> line(4*targetWidth, 0.0f);
+		int first = tapsY.first[y];
+		for(int t=tapsY.offsets[y]; t<tapsY.offsets[y+1]; ++t)
+		{
+			const float* sourceRow = &rows[4*size_t(targetWidth)*(first + t - tapsY.offsets[y])];
+			for(int x=0; x<targetWidth; ++x)
+			{
+				accumulate(&line[4*x], sourceRow + 4*x, tapsY.weights[t]);
+			}
+		}
+
+		unsigned char* targetRow = target + 4*size_t(targetWidth)*y;
+		for(int i=0; i<4*targetWidth; ++i)
+		{
+			targetRow[i] = (unsigned char) std::min(255.0f, line[i] + 0.5f);
+		}
+	}
+}
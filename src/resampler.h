@@ -0,0 +1,8 @@
+#ifndef RESAMPLER_H
+#define RESAMPLER_H
+
+//! Resamples a 32bit RGBA image to another size
+//! Every target pixel is the area weighted average of the source pixels it covers, enlarged pixels are repeated.
+void resampleImage(const unsigned char* source, int sourceWidth, int sourceHeight, unsigned char* target, int targetWidth, int targetHeight);
+
+#endif
@@ -0,0 +1,200 @@
+#include "resolver.h"
+#include "inputStream.h"
+
+#include <cctype>
+
+#include <boost/iostreams/device/array.hpp>
+#include <boost/iostreams/stream.hpp>
+
+//=================================================================================================
+// Disk files
+//=================================================================================================
+DiskFileResolver::DiskFileResolver(const std::string& rootDirectory)
+{
+	mRootDirectory = rootDirectory;
+}
+
+boost::shared_ptr<std::istream> DiskFileResolver::open(const std::string& filename)
+{
+	if (mRootDirectory.empty())
+	{
+		return openInputFile(filename);
+	}
+
+	// Names leaving the root directory are treated as missing files
+	std::string relativeFilename = normalizeFilename(filename);
+	if (relativeFilename.empty() || isAbsoluteFilename(relativeFilename) || relativeFilename == ".." || relativeFilename.compare(0, 3, "../") == 0)
+	{
+		return boost::shared_ptr<std::istream>();
+	}
+	return openInputFile(mRootDirectory + "/" + relativeFilename);
+}
+
+//=================================================================================================
+// Memory files
+//=================================================================================================
+MemoryFileResolver::MemoryFileResolver(FileResolver* fallback)
+{
+	mFallback = fallback;
+}
+
+void MemoryFileResolver::addFile(const std::string& filename, const std::string& data)
+{
+	mFiles[filename] = data;
+}
+
+boost::shared_ptr<std::istream> MemoryFileResolver::open(const std::string& filename)
+{
+	std::map<std::string, std::string>::const_iterator it = mFiles.find(filename);
+	if (it == mFiles.end())
+	{
+		return mFallback ? mFallback->open(filename) : boost::shared_ptr<std::istream>();
+	}
+
+	// The stream reads the buffer in place, it stays valid as long as the resolver
+	typedef boost::iostreams::stream<boost::iostreams::array_source> ArrayStreamType;
+	const std::string& data = it->second;
+	return boost::shared_ptr<std::istream>(new ArrayStreamType(data.data(), data.size()));
+}
+
+//=================================================================================================
+// Recording resolver
+//=================================================================================================
+RecordingFileResolver::RecordingFileResolver(FileResolver& resolver)
+	: mResolver(resolver)
+{
+}
+
+boost::shared_ptr<std::istream> RecordingFileResolver::open(const std::string& filename)
+{
+	boost::shared_ptr<std::istream> stream = mResolver.open(filename);
+	if (stream)
+	{
+		mFilenames.push_back(filename);
+	}
+	return stream;
+}
+
+//=================================================================================================
+// File names
+//=================================================================================================
+inline bool isPathSeparator(char c)
+{
+	return c == '/' || c == '\\';
+}
+
+bool isAbsoluteFilename(const std::string& filename)
+{
+	if (!filename.empty() && isPathSeparator(filename[0]))
+	{
+		return true;
+	}
+	return filename.size() >= 2 && filename[1] == ':' && isalpha((unsigned char) filename[0]);
+}
+
+std::string normalizeFilename(const std::string& filename)
+{
+	// The root ("/" or a drive letter) is kept, ".." cannot go above it
+	std::string root;
+	size_t start = 0;
+	if (filename.size() >= 2 && filename[1] == ':' && isalpha((unsigned char) filename[0]))
+	{
+		root = filename.substr(0, 2);
+		start = 2;
+	}
+	if (start < filename.size() && isPathSeparator(filename[start]))
+	{
+		root += "/";
+	}
+
+	std::vector<std::string> components;
+	while(start < filename.size())
+	{
+		size_t end = start;
+		while(end < filename.size() && !isPathSeparator(filename[end]))
+		{
+			++end;
+		}
+		std::string component = filename.substr(start, end - start);
+		if (component == "..")
+		{
+			if (!components.empty() && components.back() != "..")
+			{
+				components.pop_back();
+			}
+			else if (root.empty() || root[root.size()-1] != '/')
+			{
+				components.push_back(component);
+			}
+		}
+		else if (!component.empty() && component != ".")
+		{
+			components.push_back(component);
+		}
+		start = end + 1;
+	}
+
+	std::string result = root;
+	for(size_t i=0; i<components.size(); ++i)
+	{
+		if (i > 0)
+		{
+			result += "/";
+		}
+		result += components[i];
+	}
+	return result;
+}
+
+std::string resolveRelativeFilename(const std::string& referencingFilename, const std::string& filename)
+{
+	if (filename.empty() || isAbsoluteFilename(filename))
+	{
+		return filename;
+	}
+	size_t slash = referencingFilename.find_last_of("/\\");
+	if (slash == std::string::npos)
+	{
+		return normalizeFilename(filename);
+	}
+	return normalizeFilename(referencingFilename.substr(0, slash + 1) + filename);
+}
+
+//=================================================================================================
+// Reads the remainder of a stream
+//=================================================================================================
+void readStream(std::istream& stream, std::string& data)
+{
+	data.clear();
+	char buffer[65536];
+	while(stream)
+	{
+		stream.read(buffer, sizeof(buffer));
+		data.append(buffer, (size_t) stream.gcount());
+	}
+}
+
+//=================================================================================================
+// 64-bit FNV-1a hash
+//=================================================================================================
+unsigned long long hashData(const char* data, size_t size, unsigned long long hash)
+{
+	for(size_t i=0; i<size; ++i)
+	{
+		hash ^= (unsigned char) data[i];
+		hash *= 1099511628211ULL;
+	}
+	return hash;
+}
+
+unsigned long long hashStream(std::istream& stream)
+{
+	unsigned long long hash = hashSeed;
+	char buffer[65536];
+	while(stream)
+	{
+		stream.read(buffer, sizeof(buffer));
+		hash = hashData(buffer, (size_t) stream.gcount(), hash);
+	}
+	return hash;
+}
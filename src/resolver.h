@@ -0,0 +1,78 @@
+#ifndef RESOLVER_H
+#define RESOLVER_H
+
+#include <istream>
+#include <string>
+#include <map>
+#include <vector>
+
+#include <boost/shared_ptr.hpp>
+
+//! Opens the files referenced while baking: obj files, material libraries and textures
+class FileResolver
+{
+public:
+	virtual ~FileResolver() {}
+	//! Opens a file for reading, returns an empty pointer if it does not exist
+	virtual boost::shared_ptr<std::istream> open(const std::string& filename) = 0;
+};
+
+//! Opens files from disk, gzip and zstd compressed files are decompressed
+//! A resolver with a root directory only opens relative names that stay below it.
+class DiskFileResolver : public FileResolver
+{
+private:
+	std::string mRootDirectory;
+public:
+	DiskFileResolver(const std::string& rootDirectory = std::string());
+	virtual boost::shared_ptr<std::istream> open(const std::string& filename);
+};
+
+//! Opens files from memory buffers, files that were not added are opened with an optional fallback resolver
+class MemoryFileResolver : public FileResolver
+{
+private:
+	std::map<std::string, std::string> mFiles;
+	FileResolver*                      mFallback;
+public:
+	MemoryFileResolver(FileResolver* fallback = NULL);
+	//! Adds a file, the resolver keeps a copy of the data
+	void addFile(const std::string& filename, const std::string& data);
+	virtual boost::shared_ptr<std::istream> open(const std::string& filename);
+};
+
+//! Opens files with another resolver and remembers their names, in the order they were opened
+class RecordingFileResolver : public FileResolver
+{
+private:
+	FileResolver&            mResolver;
+	std::vector<std::string> mFilenames;
+public:
+	RecordingFileResolver(FileResolver& resolver);
+	const std::vector<std::string>& getFilenames() const { return mFilenames; }
+	virtual boost::shared_ptr<std::istream> open(const std::string& filename);
+};
+
+//! Checks if a file name is absolute, with a leading slash or a drive letter
+bool isAbsoluteFilename(const std::string& filename);
+
+//! Removes "." and empty components and resolves ".." components where possible, separators become forward slashes
+std::string normalizeFilename(const std::string& filename);
+
+//! Resolves a name referenced by a file (a material library or texture) relative to the directory of that file,
+//! absolute names are kept as they are
+std::string resolveRelativeFilename(const std::string& referencingFilename, const std::string& filename);
+
+//! Reads the remainder of a stream
+void readStream(std::istream& stream, std::string& data);
+
+// Initial value of FNV-1a hashes
+const unsigned long long hashSeed = 14695981039346656037ULL;
+
+//! 64-bit FNV-1a hash of a buffer, a buffer can be hashed in parts by passing the hash of the previous part
+unsigned long long hashData(const char* data, size_t size, unsigned long long hash = hashSeed);
+
+//! Hashes the remainder of a stream in blocks
+unsigned long long hashStream(std::istream& stream);
+
+#endif
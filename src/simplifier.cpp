@@ -0,0 +1,667 @@
+#include "simplifier.h"
+#include <algorithm>
+#include <queue>
+#include <cmath>
+
+// Number of regions along each axis that are simplified in parallel
+const int regionGridSize = 4;
+
+// Minimum cosine of the angle between the normals of a face before and after a collapse
+const double minNormalCosine = 0.2;
+
+//=================================================================================================
+// Symmetric 4x4 error quadric, stored as its upper triangle
+//=================================================================================================
+struct Quadric
+{
+	double a[10];
+
+	Quadric()
+	{
+		std::fill(a, a+10, 0.0);
+	}
+
+	//! Adds the squared distance to the plane n*p + d = 0
+	void addPlane(double nx, double ny, double nz, double d, double weight)
+	{
+		a[0] += weight*nx*nx; a[1] += weight*nx*ny; a[2] += weight*nx*nz; a[3] += weight*nx*d;
+		a[4] += weight*ny*ny; a[5] += weight*ny*nz; a[6] += weight*ny*d;
+		a[7] += weight*nz*nz; a[8] += weight*nz*d;
+		a[9] += weight*d*d;
+	}
+
+	void add(const Quadric& q)
+	{
+		for(int i=0; i<10; ++i)
+		{
+			a[i] += q.a[i];
+		}
+	}
+
+	double evaluate(const Vector3f& p) const
+	{
+		double x = p.data[0], y = p.data[1], z = p.data[2];
+		return a[0]*x*x + 2*a[1]*x*y + 2*a[2]*x*z + 2*a[3]*x
+			+ a[4]*y*y + 2*a[5]*y*z + 2*a[6]*y
+			+ a[7]*z*z + 2*a[8]*z
+			+ a[9];
+	}
+};
+
+//=================================================================================================
+// Candidate collapse of the vertex from into the vertex to
+// The versions detect candidates that became outdated by other collapses.
+//=================================================================================================
+struct Collapse
+{
+	double cost;
+	int    from;
+	int    to;
+	int    fromVersion;
+	int    toVersion;
+
+	//! Orders the priority queue by increasing cost
+	bool operator<(const Collapse& other) const
+	{
+		return cost > other.cost;
+	}
+};
+
+typedef std::priority_queue<Collapse> CollapseQueueType;
+
+//=================================================================================================
+// Connectivity and error state of the mesh being simplified
+//=================================================================================================
+struct SimplifierState
+{
+	const std::vector<Vector3f>*    positions;
+	const std::vector<Vector3f>*    normals;   //!< NULL if the mesh has no normal per vertex
+	const std::vector<Vector2f>*    texcoords; //!< NULL if the mesh has no texture coordinate per vertex
+	std::vector<Vector3i>           faces;
+	std::vector<int>                faceComponent;
+	std::vector<char>               faceRemoved;
+	std::vector<std::vector<int> >  vertexFaces;
+	std::vector<Quadric>            quadrics;
+	std::vector<char>               locked;
+	std::vector<char>               removed;
+	std::vector<int>                version;
+	std::vector<int>                region;
+};
+
+//=================================================================================================
+// Cross product of the edges of a triangle
+//=================================================================================================
+void faceNormal(const Vector3f& p0, const Vector3f& p1, const Vector3f& p2, double normal[3])
+{
+	double e1[3] = {p1.data[0]-p0.data[0], p1.data[1]-p0.data[1], p1.data[2]-p0.data[2]};
+	double e2[3] = {p2.data[0]-p0.data[0], p2.data[1]-p0.data[1], p2.data[2]-p0.data[2]};
+	normal[0] = e1[1]*e2[2]-e1[2]*e2[1];
+	normal[1] = e1[2]*e2[0]-e1[0]*e2[2];
+	normal[2] = e1[0]*e2[1]-e1[1]*e2[0];
+}
+
+//=================================================================================================
+// Compares the position, normal and texture coordinate of two vertices, the first attribute that differs decides
+//=================================================================================================
+template<typename VectorType>
+int compareAttribute(const std::vector<VectorType>* values, int a, int b)
+{
+	if (!values)
+	{
+		return 0;
+	}
+	const VectorType& va = (*values)[a];
+	const VectorType& vb = (*values)[b];
+	for(size_t k=0; k<sizeof(va.data)/sizeof(va.data[0]); ++k)
+	{
+		if (va.data[k] != vb.data[k])
+		{
+			return va.data[k] < vb.data[k] ? -1 : 1;
+		}
+	}
+	return 0;
+}
+
+struct VertexLess
+{
+	const SimplifierState& state;
+	VertexLess(const SimplifierState& state) : state(state) {}
+	bool operator()(int a, int b) const
+	{
+		int order = compareAttribute(state.positions, a, b);
+		if (order == 0)
+		{
+			order = compareAttribute(state.normals, a, b);
+		}
+		if (order == 0)
+		{
+			order = compareAttribute(state.texcoords, a, b);
+		}
+		return order < 0;
+	}
+};
+
+//=================================================================================================
+// Merges vertices whose position and attributes are equal, such as vertices left unwelded, and locks the
+// vertices that were split at texture or normal seams. Faces that lose a corner are removed.
+//=================================================================================================
+void mergeDuplicateVertices(SimplifierState& state)
+{
+	std::vector<int> sorted(state.positions->size());
+	for(size_t i=0; i<sorted.size(); ++i)
+	{
+		sorted[i] = (int) i;
+	}
+	std::sort(sorted.begin(), sorted.end(), VertexLess(state));
+
+	std::vector<int> canonical(sorted.size());
+	for(size_t i=0; i<sorted.size();)
+	{
+		// Vertices at one position, ordered by their attributes
+		size_t j = i+1;
+		while(j<sorted.size() && compareAttribute(state.positions, sorted[i], sorted[j]) == 0)
+		{
+			++j;
+		}
+		bool seam = false;
+		for(size_t k=i; k<j; ++k)
+		{
+			bool equal = k > i && !VertexLess(state)(sorted[k-1], sorted[k]);
+			canonical[sorted[k]] = equal ? canonical[sorted[k-1]] : sorted[k];
+			seam |= k > i && !equal;
+		}
+		for(size_t k=i; seam && k<j; ++k)
+		{
+			state.locked[sorted[k]] = 1;
+		}
+		i = j;
+	}
+
+	for(size_t f=0; f<state.faces.size(); ++f)
+	{
+		Vector3i& face = state.faces[f];
+		for(int k=0; k<3; ++k)
+		{
+			face.data[k] = canonical[face.data[k]];
+		}
+		if (face.data[0] == face.data[1] || face.data[1] == face.data[2] || face.data[2] == face.data[0])
+		{
+			state.faceRemoved[f] = 1;
+		}
+	}
+}
+
+//=================================================================================================
+// Locks vertices on open or non-manifold edges
+//=================================================================================================
+void lockBoundaryVertices(SimplifierState& state)
+{
+	std::vector<std::pair<int, int> > edges;
+	edges.reserve(3*state.faces.size());
+	for(size_t f=0; f<state.faces.size(); ++f)
+	{
+		if (state.faceRemoved[f])
+		{
+			continue;
+		}
+		const Vector3i& face = state.faces[f];
+		for(int k=0; k<3; ++k)
+		{
+			int a = face.data[k];
+			int b = face.data[(k+1)%3];
+			edges.push_back(std::make_pair(std::min(a, b), std::max(a, b)));
+		}
+	}
+	std::sort(edges.begin(), edges.end());
+	for(size_t i=0; i<edges.size();)
+	{
+		size_t j = i+1;
+		while(j<edges.size() && edges[j]==edges[i])
+		{
+			++j;
+		}
+		if (j-i != 2)
+		{
+			state.locked[edges[i].first] = 1;
+			state.locked[edges[i].second] = 1;
+		}
+		i = j;
+	}
+}
+
+//=================================================================================================
+// Sums the area weighted plane quadrics of the faces around each vertex
+//=================================================================================================
+void computeQuadrics(SimplifierState& state)
+{
+	const std::vector<Vector3f>& positions = *state.positions;
+	for(size_t f=0; f<state.faces.size(); ++f)
+	{
+		if (state.faceRemoved[f])
+		{
+			continue;
+		}
+		const Vector3i& face = state.faces[f];
+		const Vector3f& p0 = positions[face.data[0]];
+		double normal[3];
+		faceNormal(p0, positions[face.data[1]], positions[face.data[2]], normal);
+		double length = sqrt(normal[0]*normal[0] + normal[1]*normal[1] + normal[2]*normal[2]);
+		if (length <= 0.0)
+		{
+			continue;
+		}
+		double nx = normal[0]/length, ny = normal[1]/length, nz = normal[2]/length;
+		double d = -(nx*p0.data[0] + ny*p0.data[1] + nz*p0.data[2]);
+		for(int k=0; k<3; ++k)
+		{
+			state.quadrics[face.data[k]].addPlane(nx, ny, nz, d, 0.5*length);
+		}
+	}
+}
+
+//=================================================================================================
+// Assigns the vertices to the cells of a regular grid over the bounding box
+//=================================================================================================
+void assignRegions(SimplifierState& state, int gridSize)
+{
+	const std::vector<Vector3f>& positions = *state.positions;
+	if (positions.empty())
+	{
+		return;
+	}
+
+	float minimum[3], maximum[3];
+	for(int k=0; k<3; ++k)
+	{
+		minimum[k] = maximum[k] = positions[0].data[k];
+	}
+	for(size_t i=1; i<positions.size(); ++i)
+	{
+		for(int k=0; k<3; ++k)
+		{
+			minimum[k] = std::min(minimum[k], positions[i].data[k]);
+			maximum[k] = std::max(maximum[k], positions[i].data[k]);
+		}
+	}
+
+	for(size_t i=0; i<positions.size(); ++i)
+	{
+		int cell[3];
+		for(int k=0; k<3; ++k)
+		{
+			float extent = maximum[k] - minimum[k];
+			cell[k] = extent > 0.0f ? (int) ((positions[i].data[k] - minimum[k]) / extent * gridSize) : 0;
+			cell[k] = std::min(cell[k], gridSize-1);
+		}
+		state.region[i] = (cell[2]*gridSize + cell[1])*gridSize + cell[0];
+	}
+}
+
+//=================================================================================================
+// Checks whether collapsing from into to keeps the mesh manifold and all faces inside the region
+//=================================================================================================
+bool canCollapse(const SimplifierState& state, int from, int to, int regionId, std::vector<int>& fromNeighbours, std::vector<int>& toNeighbours)
+{
+	if (state.removed[from] || state.removed[to] || state.locked[from])
+	{
+		return false;
+	}
+	if (state.region[from] != regionId || state.region[to] != regionId)
+	{
+		return false;
+	}
+
+	const std::vector<Vector3f>& positions = *state.positions;
+	const std::vector<int>& faces = state.vertexFaces[from];
+	int sharedFaces = 0;
+	fromNeighbours.clear();
+	for(size_t i=0; i<faces.size(); ++i)
+	{
+		const Vector3i& face = state.faces[faces[i]];
+		bool hasTo = false;
+		for(int k=0; k<3; ++k)
+		{
+			if (state.region[face.data[k]] != regionId)
+			{
+				return false;
+			}
+			hasTo |= face.data[k] == to;
+			if (face.data[k] != from)
+			{
+				fromNeighbours.push_back(face.data[k]);
+			}
+		}
+		if (hasTo)
+		{
+			sharedFaces++;
+			continue;
+		}
+
+		// Reject collapses that flip a face or turn it by more than about 80 degrees
+		Vector3f moved[3];
+		for(int k=0; k<3; ++k)
+		{
+			moved[k] = positions[face.data[k] == from ? to : face.data[k]];
+		}
+		double before[3], after[3];
+		faceNormal(positions[face.data[0]], positions[face.data[1]], positions[face.data[2]], before);
+		faceNormal(moved[0], moved[1], moved[2], after);
+		double dot = before[0]*after[0] + before[1]*after[1] + before[2]*after[2];
+		double lengths = (before[0]*before[0] + before[1]*before[1] + before[2]*before[2]) * (after[0]*after[0] + after[1]*after[1] + after[2]*after[2]);
+		if (dot <= 0.0 || dot*dot < minNormalCosine*minNormalCosine*lengths)
+		{
+			return false;
+		}
+	}
+	if (sharedFaces == 0)
+	{
+		return false;
+	}
+
+	// Link condition: the common neighbours have to be the opposite vertices of the shared faces
+	toNeighbours.clear();
+	const std::vector<int>& otherFaces = state.vertexFaces[to];
+	for(size_t i=0; i<otherFaces.size(); ++i)
+	{
+		const Vector3i& face = state.faces[otherFaces[i]];
+		for(int k=0; k<3; ++k)
+		{
+			if (face.data[k] != to)
+			{
+				toNeighbours.push_back(face.data[k]);
+			}
+		}
+	}
+	std::sort(fromNeighbours.begin(), fromNeighbours.end());
+	fromNeighbours.erase(std::unique(fromNeighbours.begin(), fromNeighbours.end()), fromNeighbours.end());
+	std::sort(toNeighbours.begin(), toNeighbours.end());
+	toNeighbours.erase(std::unique(toNeighbours.begin(), toNeighbours.end()), toNeighbours.end());
+
+	int commonNeighbours = 0;
+	std::vector<int>::const_iterator a = fromNeighbours.begin();
+	std::vector<int>::const_iterator b = toNeighbours.begin();
+	while(a != fromNeighbours.end() && b != toNeighbours.end())
+	{
+		if (*a < *b)
+		{
+			++a;
+		}
+		else if (*b < *a)
+		{
+			++b;
+		}
+		else
+		{
+			commonNeighbours++;
+			++a;
+			++b;
+		}
+	}
+	return commonNeighbours == sharedFaces;
+}
+
+//=================================================================================================
+// Removes the faces shared by from and to, and moves the other faces of from to to
+// Returns the number of removed faces
+//=================================================================================================
+int collapse(SimplifierState& state, int from, int to)
+{
+	int removedFaces = 0;
+	std::vector<int>& faces = state.vertexFaces[from];
+	for(size_t i=0; i<faces.size(); ++i)
+	{
+		int f = faces[i];
+		Vector3i& face = state.faces[f];
+		if (face.data[0] == to || face.data[1] == to || face.data[2] == to)
+		{
+			state.faceRemoved[f] = 1;
+			removedFaces++;
+			for(int k=0; k<3; ++k)
+			{
+				if (face.data[k] != from)
+				{
+					std::vector<int>& other = state.vertexFaces[face.data[k]];
+					other.erase(std::remove(other.begin(), other.end(), f), other.end());
+				}
+			}
+		}
+		else
+		{
+			for(int k=0; k<3; ++k)
+			{
+				if (face.data[k] == from)
+				{
+					face.data[k] = to;
+				}
+			}
+			state.vertexFaces[to].push_back(f);
+		}
+	}
+	faces.clear();
+
+	state.quadrics[to].add(state.quadrics[from]);
+	state.removed[from] = 1;
+	state.version[from]++;
+	state.version[to]++;
+	return removedFaces;
+}
+
+//=================================================================================================
+// Queues the collapse of from into to
+//=================================================================================================
+void queueCollapse(const SimplifierState& state, int from, int to, int regionId, CollapseQueueType& queue)
+{
+	if (state.locked[from] || state.region[from] != regionId || state.region[to] != regionId)
+	{
+		return;
+	}
+	Quadric quadric = state.quadrics[from];
+	quadric.add(state.quadrics[to]);
+
+	Collapse candidate;
+	candidate.cost = quadric.evaluate((*state.positions)[to]);
+	candidate.from = from;
+	candidate.to = to;
+	candidate.fromVersion = state.version[from];
+	candidate.toVersion = state.version[to];
+	queue.push(candidate);
+}
+
+//=================================================================================================
+// Collapses the cheapest edges of one region until faceReduction faces are removed
+// Only faces with all vertices inside the region are changed, so regions can be simplified in parallel.
+//=================================================================================================
+size_t simplifyRegion(SimplifierState& state, int regionId, const std::vector<int>& regionFaces, size_t faceReduction)
+{
+	CollapseQueueType queue;
+	for(size_t i=0; i<regionFaces.size(); ++i)
+	{
+		const Vector3i& face = state.faces[regionFaces[i]];
+		for(int k=0; k<3; ++k)
+		{
+			queueCollapse(state, face.data[k], face.data[(k+1)%3], regionId, queue);
+			queueCollapse(state, face.data[(k+1)%3], face.data[k], regionId, queue);
+		}
+	}
+
+	std::vector<int> fromNeighbours, toNeighbours;
+	size_t removedFaces = 0;
+	while(removedFaces < faceReduction && !queue.empty())
+	{
+		Collapse candidate = queue.top();
+		queue.pop();
+		if (candidate.fromVersion != state.version[candidate.from] || candidate.toVersion != state.version[candidate.to])
+		{
+			continue;
+		}
+		if (!canCollapse(state, candidate.from, candidate.to, regionId, fromNeighbours, toNeighbours))
+		{
+			continue;
+		}
+		removedFaces += collapse(state, candidate.from, candidate.to);
+
+		// Requeue the edges around the merged vertex with the new quadric
+		int to = candidate.to;
+		const std::vector<int>& faces = state.vertexFaces[to];
+		for(size_t i=0; i<faces.size(); ++i)
+		{
+			const Vector3i& face = state.faces[faces[i]];
+			for(int k=0; k<3; ++k)
+			{
+				if (face.data[k] != to)
+				{
+					queueCollapse(state, to, face.data[k], regionId, queue);
+					queueCollapse(state, face.data[k], to, regionId, queue);
+				}
+			}
+		}
+	}
+	return removedFaces;
+}
+
+//=================================================================================================
+// Returns the number of faces of all components
+//=================================================================================================
+size_t countFaces(const Mesh& mesh)
+{
+	size_t count = 0;
+	for(ComponentListType::const_iterator ic=mesh.components.begin(); ic!=mesh.components.end(); ++ic)
+	{
+		count += ic->faces.size();
+	}
+	return count;
+}
+
+//=================================================================================================
+// Simplifies a mesh with quadric error half-edge collapses
+//=================================================================================================
+void simplifyMesh(const Mesh& mesh, size_t targetFaceCount, Mesh& result)
+{
+	size_t vertexCount = mesh.vertices.size();
+	bool hasNormals = mesh.normals.size() == vertexCount;
+	bool hasTexCoord = mesh.texcoord.size() == vertexCount;
+	SimplifierState state;
+	state.positions = &mesh.vertices;
+	state.normals = hasNormals ? &mesh.normals : NULL;
+	state.texcoords = hasTexCoord ? &mesh.texcoord : NULL;
+	for(size_t c=0; c<mesh.components.size(); ++c)
+	{
+		const std::vector<Vector3i>& faces = mesh.components[c].faces;
+		state.faces.insert(state.faces.end(), faces.begin(), faces.end());
+		state.faceComponent.resize(state.faces.size(), (int) c);
+	}
+	state.faceRemoved.resize(state.faces.size(), 0);
+	state.vertexFaces.resize(vertexCount);
+	state.quadrics.resize(vertexCount);
+	state.locked.resize(vertexCount, 0);
+	state.removed.resize(vertexCount, 0);
+	state.version.resize(vertexCount, 0);
+	state.region.resize(vertexCount, 0);
+
+	mergeDuplicateVertices(state);
+	lockBoundaryVertices(state);
+	size_t faceCount = 0;
+	for(size_t f=0; f<state.faces.size(); ++f)
+	{
+		if (state.faceRemoved[f])
+		{
+			continue;
+		}
+		for(int k=0; k<3; ++k)
+		{
+			state.vertexFaces[state.faces[f].data[k]].push_back((int) f);
+		}
+		faceCount++;
+	}
+	computeQuadrics(state);
+
+	if (targetFaceCount < faceCount)
+	{
+		// Simplify the inside of each region in parallel, each one by the same ratio
+		int regionCount = regionGridSize*regionGridSize*regionGridSize;
+		assignRegions(state, regionGridSize);
+		std::vector<std::vector<int> > regionFaces(regionCount);
+		for(size_t f=0; f<state.faces.size(); ++f)
+		{
+			const Vector3i& face = state.faces[f];
+			int regionId = state.region[face.data[0]];
+			if (!state.faceRemoved[f] && state.region[face.data[1]] == regionId && state.region[face.data[2]] == regionId)
+			{
+				regionFaces[regionId].push_back((int) f);
+			}
+		}
+
+		double ratio = double(faceCount - targetFaceCount) / faceCount;
+		std::vector<size_t> removedFaces(regionCount, 0);
+		#pragma omp parallel for schedule(dynamic)
+		for(int r=0; r<regionCount; ++r)
+		{
+			if (!regionFaces[r].empty())
+			{
+				removedFaces[r] = simplifyRegion(state, r, regionFaces[r], (size_t) (regionFaces[r].size()*ratio));
+			}
+		}
+		for(int r=0; r<regionCount; ++r)
+		{
+			faceCount -= removedFaces[r];
+		}
+
+		// Simplify the borders between the regions, and whatever the regions left
+		if (targetFaceCount < faceCount)
+		{
+			std::fill(state.region.begin(), state.region.end(), 0);
+			std::vector<int> remainingFaces;
+			for(size_t f=0; f<state.faces.size(); ++f)
+			{
+				if (!state.faceRemoved[f])
+				{
+					remainingFaces.push_back((int) f);
+				}
+			}
+			faceCount -= simplifyRegion(state, 0, remainingFaces, faceCount - targetFaceCount);
+		}
+	}
+
+	// Copy the remaining faces and the vertices they use
+	result.vertices.clear();
+	result.normals.clear();
+	result.texcoord.clear();
+	result.materials = mesh.materials;
+	result.materialNames = mesh.materialNames;
+	result.components.resize(mesh.components.size());
+	for(size_t c=0; c<mesh.components.size(); ++c)
+	{
+		result.components[c].materialId = mesh.components[c].materialId;
+		result.components[c].componentName = mesh.components[c].componentName;
+		result.components[c].faces.clear();
+	}
+
+	std::vector<int> vertexMap(vertexCount, -1);
+	for(size_t f=0; f<state.faces.size(); ++f)
+	{
+		if (state.faceRemoved[f])
+		{
+			continue;
+		}
+		Vector3i face = state.faces[f];
+		for(int k=0; k<3; ++k)
+		{
+			int& mapped = vertexMap[face.data[k]];
+			if (mapped < 0)
+			{
+				mapped = (int) result.vertices.size();
+				result.vertices.push_back(mesh.vertices[face.data[k]]);
+				if (hasNormals)
+				{
+					result.normals.push_back(mesh.normals[face.data[k]]);
+				}
+				if (hasTexCoord)
+				{
+					result.texcoord.push_back(mesh.texcoord[face.data[k]]);
+				}
+			}
+			face.data[k] = mapped;
+		}
+		result.components[state.faceComponent[f]].faces.push_back(face);
+	}
+}
@@ -0,0 +1,16 @@
+#ifndef SIMPLIFIER_H
+#define SIMPLIFIER_H
+
+#include "objTypes.h"
+
+//! Returns the number of faces of all components
+size_t countFaces(const Mesh& mesh);
+
+//! Simplifies a triangle mesh to about targetFaceCount faces with quadric error edge collapses
+//! Only half-edge collapses are used, so the remaining vertices keep their attributes and all faces
+//! stay inside their atlas tile. Vertices with equal position and attributes are merged first, so only
+//! boundary vertices and vertices split at texture or normal seams are never moved.
+//! Spatial regions of large meshes are simplified in parallel, the borders between them afterwards.
+void simplifyMesh(const Mesh& mesh, size_t targetFaceCount, Mesh& result);
+
+#endif
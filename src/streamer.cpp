@@ -0,0 +1,377 @@
+#include "streamer.h"
+#include "parser.h"
+#include "packer.h"
+#include "inputStream.h"
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+
+//=================================================================================================
+// Opens an obj file for reading
+//=================================================================================================
+boost::shared_ptr<std::istream> openObj(const std::string& filename)
+{
+	boost::shared_ptr<std::istream> infile = openInputFile(filename);
+	if(!infile)
+	{
+		throw std::runtime_error("Unable to open mesh file: " + filename);
+	}
+	return infile;
+}
+
+//=================================================================================================
+// Reads the command of an obj line, returns false for comments and empty lines
+//=================================================================================================
+bool readCommand(const std::string& line, std::istringstream& stream, std::string& type)
+{
+	if(line.length()==0 || line[0] == '#')
+	{
+		return false;
+	}
+
+	stream.clear();
+	stream.str(line);
+	type.clear();
+	stream >> type;
+	std::transform(type.begin(), type.end(), type.begin(), tolower);
+	return !type.empty();
+}
+
+//=================================================================================================
+// Texture coordinates that are used by faces with different tile transforms
+// These are written once for each transform, all copies directly follow each other in the output.
+//=================================================================================================
+struct SharedTexcoords
+{
+	std::vector<int>              indices;    //!< Sorted input indices of shared texture coordinates
+	std::vector<int>              copyOffset; //!< Number of extra copies written before indices[i]
+	std::vector<std::vector<int> > copySlots; //!< Transform slots of the extra copies of indices[i]
+
+	//! Returns the (0-based) output index of the input texture coordinate transformed with the given slot
+	int outputIndex(int index, int ownerSlot, int slot) const
+	{
+		size_t k = std::lower_bound(indices.begin(), indices.end(), index) - indices.begin();
+		int result = index + copyOffset[k];
+		if (k < indices.size() && indices[k] == index && slot != ownerSlot)
+		{
+			const std::vector<int>& slots = copySlots[k];
+			result += 1 + int(std::find(slots.begin(), slots.end(), slot) - slots.begin());
+		}
+		return result;
+	}
+};
+
+//=================================================================================================
+// Writes one face vertex
+//=================================================================================================
+void writeFaceVertex(std::ofstream& outfile, int vertex, int normal, int texcoord, bool hasNormals, bool hasTexCoord)
+{
+	outfile << vertex + 1;
+	if (hasTexCoord)
+	{
+		outfile << "/" << texcoord + 1;
+	}
+	else if (hasNormals)
+	{
+		outfile << "/";
+	}
+	if (hasNormals)
+	{
+		outfile << "/" << normal + 1;
+	}
+}
+
+//=================================================================================================
+// Bakes an obj file in two streaming passes
+//=================================================================================================
+void bakeObjStreaming(const BakeOptions& options, const std::string& inputFilename, const std::string& outputFilename, const std::string& matFilename, const std::string& textureFilename)
+{
+	std::string line;
+	std::string type;
+	std::istringstream stream;
+	std::vector<Vector3i> loadedIndices;
+
+	// Material ids, id 0 is used for faces without a material
+	std::map<std::string, int> materialIds;
+	std::vector<std::string> materialNames(1);
+	std::vector<bool> materialUsed(1, true);
+	MaterialMapType materials;
+
+	// Material of the first face using each texture coordinate (-1 if not used at all),
+	// and all other materials using the same texture coordinate
+	std::vector<int> texcoordMaterial;
+	std::map<int, std::vector<int> > texcoordExtraMaterials;
+
+	int vertexCount = 0;
+	int normalCount = 0;
+
+	// Whether any face vertex references a normal or texture coordinate that was not defined before it
+	bool unknownNormals = false;
+	bool unknownTexcoords = false;
+
+	// First pass: materials and texture coordinate usage
+	{
+		boost::shared_ptr<std::istream> infile = openObj(inputFilename);
+
+		int currentMaterial = 0;
+		while(getline(*infile, line))
+		{
+			if(!readCommand(line, stream, type))
+			{
+				continue;
+			}
+
+			if(type == "mtllib")
+			{
+				std::string materialFileName;
+				stream >> materialFileName;
+				loadMaterialFile(resolveRelativeFilename(inputFilename, materialFileName), materials);
+			}
+			else if(type == "usemtl")
+			{
+				std::string name;
+				stream >> name;
+				std::map<std::string, int>::iterator it = materialIds.find(name);
+				if (it == materialIds.end())
+				{
+					it = materialIds.insert(std::make_pair(name, (int) materialNames.size())).first;
+					materialNames.push_back(name);
+					materialUsed.push_back(false);
+				}
+				currentMaterial = it->second;
+			}
+			else if(type == "v")
+			{
+				vertexCount++;
+			}
+			else if(type == "vn")
+			{
+				normalCount++;
+			}
+			else if(type == "vt")
+			{
+				texcoordMaterial.push_back(-1);
+			}
+			else if(type == "f")
+			{
+				const char* ptr = line.c_str() + (int) stream.tellg();
+				parseFace(ptr, loadedIndices, vertexCount, normalCount, (int) texcoordMaterial.size());
+				if (loadedIndices.size() < 3)
+				{
+					throw std::runtime_error("OBJ loader: face with less than 3 vertices encountered");
+				}
+
+				materialUsed[currentMaterial] = true;
+				for(size_t i=0; i<loadedIndices.size(); ++i)
+				{
+					int vertexIndex = loadedIndices[i].data[0] - 1;
+					if (vertexIndex < 0 || vertexIndex >= vertexCount)
+					{
+						throw std::runtime_error("Unknown vertex specified");
+					}
+
+					// Normal and texture coordinate indices default to the vertex index, they are only
+					// required to be valid if the file has normals or texture coordinates at all
+					int normalIndex = loadedIndices[i].data[1] - 1;
+					if (normalIndex < 0 || normalIndex >= normalCount)
+					{
+						unknownNormals = true;
+					}
+
+					int texcoordIndex = loadedIndices[i].data[2] - 1;
+					if (texcoordIndex < 0 || texcoordIndex >= (int) texcoordMaterial.size())
+					{
+						unknownTexcoords = true;
+						continue;
+					}
+
+					int& owner = texcoordMaterial[texcoordIndex];
+					if (owner < 0)
+					{
+						owner = currentMaterial;
+					}
+					else if (owner != currentMaterial)
+					{
+						std::vector<int>& extra = texcoordExtraMaterials[texcoordIndex];
+						if (std::find(extra.begin(), extra.end(), currentMaterial) == extra.end())
+						{
+							extra.push_back(currentMaterial);
+						}
+					}
+				}
+			}
+		}
+	}
+
+	// Every face vertex is written with a normal and texture coordinate if the file has any, like loadObj
+	if (normalCount > 0 && unknownNormals)
+	{
+		throw std::runtime_error("Unknown normal specified");
+	}
+	if (!texcoordMaterial.empty() && unknownTexcoords)
+	{
+		throw std::runtime_error("Unknown texture coordinate specified");
+	}
+
+	// Build the texture atlas from the used materials
+	// Texture coordinate values are not kept, so the textures are packed without cropping,
+	// and are scaled down uniformly if they exceed the atlas budget
+	MaterialUsageListType usedMaterials(materialNames.size());
+	for(size_t m=1; m<materialNames.size(); ++m)
+	{
+		if (materialUsed[m])
+		{
+			usedMaterials[m].used = true;
+			usedMaterials[m].bounds.setFull();
+		}
+	}
+	AtlasLayoutType layout;
+	packAtlas(materials, materialNames, usedMaterials, textureFilename, layout, options.maxAtlasSize, options.png);
+
+	// Assign a transform slot to every material, slot 0 is the identity
+	std::vector<TileTransform> slotTransforms(1);
+	std::vector<int> materialSlots(materialNames.size(), 0);
+	for(size_t m=1; m<layout.size(); ++m)
+	{
+		if (!layout[m].isIdentity())
+		{
+			materialSlots[m] = (int) slotTransforms.size();
+			slotTransforms.push_back(layout[m]);
+		}
+	}
+
+	// Replace materials by transform slots, texture coordinates shared between different slots get copied
+	for(size_t t=0; t<texcoordMaterial.size(); ++t)
+	{
+		texcoordMaterial[t] = texcoordMaterial[t] < 0 ? 0 : materialSlots[texcoordMaterial[t]];
+	}
+	std::vector<int>& texcoordSlot = texcoordMaterial;
+
+	SharedTexcoords shared;
+	int copyCount = 0;
+	for(std::map<int, std::vector<int> >::const_iterator it=texcoordExtraMaterials.begin(); it!=texcoordExtraMaterials.end(); ++it)
+	{
+		std::vector<int> slots;
+		for(size_t i=0; i<it->second.size(); ++i)
+		{
+			int slot = materialSlots[it->second[i]];
+			if (slot != texcoordSlot[it->first] && std::find(slots.begin(), slots.end(), slot) == slots.end())
+			{
+				slots.push_back(slot);
+			}
+		}
+		if (!slots.empty())
+		{
+			shared.indices.push_back(it->first);
+			shared.copyOffset.push_back(copyCount);
+			shared.copySlots.push_back(slots);
+			copyCount += (int) slots.size();
+		}
+	}
+	shared.copyOffset.push_back(copyCount);
+	texcoordExtraMaterials.clear();
+
+	if (copyCount > 0)
+	{
+		std::cerr << "duplicated " << copyCount << " texture coordinates shared by differently textured materials" << std::endl;
+	}
+
+	// Second pass: write the baked mesh
+	boost::shared_ptr<std::istream> infile = openObj(inputFilename);
+
+	std::ofstream outfile;
+	outfile.open(outputFilename.c_str());
+	if(!outfile.is_open())
+	{
+		throw std::runtime_error("Unable to open output mesh file: " + outputFilename);
+	}
+
+	bool hasNormals = normalCount > 0;
+	bool hasTexCoord = !texcoordSlot.empty();
+	bool hasFaces = false;
+	int currentSlot = 0;
+	int texcoordCount = 0;
+	vertexCount = 0;
+	normalCount = 0;
+
+	outfile << "mtllib " << matFilename << std::endl;
+
+	while(getline(*infile, line))
+	{
+		if(!readCommand(line, stream, type))
+		{
+			continue;
+		}
+
+		if(type == "usemtl")
+		{
+			std::string name;
+			stream >> name;
+			currentSlot = materialSlots[materialIds[name]];
+		}
+		else if(type == "v")
+		{
+			outfile << line << std::endl;
+			vertexCount++;
+		}
+		else if(type == "vn")
+		{
+			outfile << line << std::endl;
+			normalCount++;
+		}
+		else if(type == "vt")
+		{
+			Vector2f vt, baked;
+			stream >> vt.data[0] >> vt.data[1];
+
+			transformTexcoord(baked, vt, slotTransforms[texcoordSlot[texcoordCount]]);
+			outfile << "vt " << baked.data[0] << " " << baked.data[1] << std::endl;
+
+			// Copies for the other tiles using this texture coordinate
+			std::vector<int>::const_iterator it = std::lower_bound(shared.indices.begin(), shared.indices.end(), texcoordCount);
+			if (it != shared.indices.end() && *it == texcoordCount)
+			{
+				const std::vector<int>& slots = shared.copySlots[it - shared.indices.begin()];
+				for(size_t i=0; i<slots.size(); ++i)
+				{
+					transformTexcoord(baked, vt, slotTransforms[slots[i]]);
+					outfile << "vt " << baked.data[0] << " " << baked.data[1] << std::endl;
+				}
+			}
+			texcoordCount++;
+		}
+		else if(type == "f")
+		{
+			if (!hasFaces)
+			{
+				outfile << "g default" << std::endl;
+				outfile << "usemtl default" << std::endl;
+				outfile << "s " << 1 << std::endl;
+				hasFaces = true;
+			}
+
+			const char* ptr = line.c_str() + (int) stream.tellg();
+			parseFace(ptr, loadedIndices, vertexCount, normalCount, texcoordCount);
+
+			outfile << "f";
+			for(size_t i=0; i<loadedIndices.size(); ++i)
+			{
+				int texcoordIndex = loadedIndices[i].data[2] - 1;
+				if (hasTexCoord)
+				{
+					texcoordIndex = shared.outputIndex(texcoordIndex, texcoordSlot[texcoordIndex], currentSlot);
+				}
+				outfile << " ";
+				writeFaceVertex(outfile, loadedIndices[i].data[0] - 1, loadedIndices[i].data[1] - 1, texcoordIndex, hasNormals, hasTexCoord);
+			}
+			outfile << std::endl;
+		}
+	}
+	outfile.close();
+
+	// Write the material referencing the atlas
+	MaterialMapType outputMaterials;
+	outputMaterials["default"].textureDiffuse = textureFilename;
+	writeMaterialFile(matFilename, outputMaterials);
+}
@@ -0,0 +1,12 @@
+#ifndef STREAMER_H
+#define STREAMER_H
+
+#include "objTypes.h"
+#include "bakeObj.h"
+
+//! Bakes an obj file without loading the whole mesh into memory
+//! The input is read twice: the first pass collects the materials and the texture coordinates used
+//! by each material, the second pass writes the baked mesh record by record.
+void bakeObjStreaming(const BakeOptions& options, const std::string& inputFilename, const std::string& outputFilename, const std::string& matFilename, const std::string& textureFilename);
+
+#endif
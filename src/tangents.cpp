@@ -0,0 +1,240 @@
+#include "tangents.h"
+#include "normals.h"
+#include <algorithm>
+#include <cmath>
+
+//=================================================================================================
+// Winding of a face in texture space, 1 if it keeps the winding of the face, -1 if mirrored, 0 if degenerate
+//=================================================================================================
+float faceOrientation(const Mesh& mesh, const Vector3i& face)
+{
+	const float* t0 = mesh.texcoord[face.data[0]].data;
+	const float* t1 = mesh.texcoord[face.data[1]].data;
+	const float* t2 = mesh.texcoord[face.data[2]].data;
+	float determinant = (t1[0]-t0[0])*(t2[1]-t0[1]) - (t2[0]-t0[0])*(t1[1]-t0[1]);
+	return determinant > 0.0f ? 1.0f : (determinant < 0.0f ? -1.0f : 0.0f);
+}
+
+//=================================================================================================
+// Tangent direction of a face
+//=================================================================================================
+struct FaceTangent
+{
+	Vector3f tangent;     //!< Direction of increasing u, not normalized
+	float    orientation; //!< 1 if the texture coordinates keep the winding of the face, -1 if mirrored, 0 if degenerate
+	Vector3f angles;      //!< Angle at each corner
+};
+
+void computeFaceTangent(const Mesh& mesh, const Vector3i& face, FaceTangent& result)
+{
+	const float* p[3];
+	const float* t[3];
+	for(int k=0; k<3; ++k)
+	{
+		p[k] = mesh.vertices[face.data[k]].data;
+		t[k] = mesh.texcoord[face.data[k]].data;
+	}
+
+	float e1[3] = {p[1][0]-p[0][0], p[1][1]-p[0][1], p[1][2]-p[0][2]};
+	float e2[3] = {p[2][0]-p[0][0], p[2][1]-p[0][1], p[2][2]-p[0][2]};
+	float du1 = t[1][0]-t[0][0];
+	float dv1 = t[1][1]-t[0][1];
+	float du2 = t[2][0]-t[0][0];
+	float dv2 = t[2][1]-t[0][1];
+
+	// Scaling by the sign instead of dividing by the determinant keeps the direction of thin texture mappings stable
+	result.orientation = faceOrientation(mesh, face);
+	for(int k=0; k<3; ++k)
+	{
+		result.tangent.data[k] = result.orientation * (dv2*e1[k] - dv1*e2[k]);
+	}
+
+	for(int k=0; k<3; ++k)
+	{
+		const float* a = p[k];
+		const float* b = p[(k+1)%3];
+		const float* c = p[(k+2)%3];
+		float outgoing[3] = {b[0]-a[0], b[1]-a[1], b[2]-a[2]};
+		float incoming[3] = {c[0]-a[0], c[1]-a[1], c[2]-a[2]};
+		if (normalize(outgoing) > 0.0f && normalize(incoming) > 0.0f)
+		{
+			float cosine = outgoing[0]*incoming[0] + outgoing[1]*incoming[1] + outgoing[2]*incoming[2];
+			result.angles.data[k] = acos(std::max(-1.0f, std::min(1.0f, cosine)));
+		}
+		else
+		{
+			result.angles.data[k] = 0.0f;
+		}
+	}
+}
+
+//=================================================================================================
+// Gives the mirrored faces their own copy of the vertices they share with unmirrored faces
+//=================================================================================================
+int splitMirroredVertices(Mesh& mesh)
+{
+	size_t vertexCount = mesh.vertices.size();
+	if (vertexCount == 0 || mesh.normals.size() != vertexCount || mesh.texcoord.size() != vertexCount)
+	{
+		return 0;
+	}
+
+	// Orientations of the faces around each vertex, 1 for unmirrored and 2 for mirrored faces
+	std::vector<unsigned char> orientations(vertexCount, 0);
+	for(ComponentListType::const_iterator ic=mesh.components.begin(); ic!=mesh.components.end(); ++ic)
+	{
+		for(size_t f=0; f<ic->faces.size(); ++f)
+		{
+			float orientation = faceOrientation(mesh, ic->faces[f]);
+			unsigned char flag = orientation > 0.0f ? 1 : (orientation < 0.0f ? 2 : 0);
+			for(int k=0; k<3; ++k)
+			{
+				orientations[ic->faces[f].data[k]] |= flag;
+			}
+		}
+	}
+
+	// The mirrored faces move to the copies, degenerate faces keep the original vertices
+	std::vector<int> mirroredVertices(vertexCount, -1);
+	int splitCount = 0;
+	for(ComponentListType::iterator ic=mesh.components.begin(); ic!=mesh.components.end(); ++ic)
+	{
+		for(size_t f=0; f<ic->faces.size(); ++f)
+		{
+			Vector3i& face = ic->faces[f];
+			if (faceOrientation(mesh, face) >= 0.0f)
+			{
+				continue;
+			}
+			for(int k=0; k<3; ++k)
+			{
+				int vertex = face.data[k];
+				if (orientations[vertex] != 3)
+				{
+					continue;
+				}
+				if (mirroredVertices[vertex] < 0)
+				{
+					mirroredVertices[vertex] = (int) mesh.vertices.size();
+					Vector3f position = mesh.vertices[vertex];
+					Vector3f normal = mesh.normals[vertex];
+					Vector2f texcoord = mesh.texcoord[vertex];
+					mesh.vertices.push_back(position);
+					mesh.normals.push_back(normal);
+					mesh.texcoord.push_back(texcoord);
+					splitCount++;
+				}
+				face.data[k] = mirroredVertices[vertex];
+			}
+		}
+	}
+	return splitCount;
+}
+
+//=================================================================================================
+// Projects a vector into the plane of a unit normal and normalizes it
+//=================================================================================================
+float projectToPlane(const float* normal, const float* vector, float* result)
+{
+	float d = normal[0]*vector[0] + normal[1]*vector[1] + normal[2]*vector[2];
+	for(int k=0; k<3; ++k)
+	{
+		result[k] = vector[k] - d*normal[k];
+	}
+	return normalize(result);
+}
+
+//=================================================================================================
+// Generates the tangents, the faces and the vertices are processed in parallel
+//=================================================================================================
+void generateTangents(const Mesh& mesh, std::vector<Vector4f>& tangents)
+{
+	tangents.clear();
+	size_t vertexCount = mesh.vertices.size();
+	if (vertexCount == 0 || mesh.normals.size() != vertexCount || mesh.texcoord.size() != vertexCount)
+	{
+		return;
+	}
+
+	std::vector<const Vector3i*> faces;
+	for(ComponentListType::const_iterator ic=mesh.components.begin(); ic!=mesh.components.end(); ++ic)
+	{
+		for(size_t f=0; f<ic->faces.size(); ++f)
+		{
+			faces.push_back(&ic->faces[f]);
+		}
+	}
+
+	std::vector<FaceTangent> faceTangents(faces.size());
+	#pragma omp parallel for
+	for(int f=0; f<(int) faces.size(); ++f)
+	{
+		computeFaceTangent(mesh, *faces[f], faceTangents[f]);
+	}
+
+	// Face corners of each vertex, in compressed rows
+	std::vector<int> offsets(vertexCount+1, 0);
+	for(size_t f=0; f<faces.size(); ++f)
+	{
+		for(int k=0; k<3; ++k)
+		{
+			offsets[faces[f]->data[k]+1]++;
+		}
+	}
+	for(size_t i=0; i<vertexCount; ++i)
+	{
+		offsets[i+1] += offsets[i];
+	}
+	std::vector<int> vertexCorners(offsets[vertexCount]);
+	std::vector<int> fill(offsets.begin(), offsets.end()-1);
+	for(size_t f=0; f<faces.size(); ++f)
+	{
+		for(int k=0; k<3; ++k)
+		{
+			vertexCorners[fill[faces[f]->data[k]]++] = (int) (3*f + k);
+		}
+	}
+
+	tangents.resize(vertexCount);
+	#pragma omp parallel for
+	for(int i=0; i<(int) vertexCount; ++i)
+	{
+		const float* normal = mesh.normals[i].data;
+
+		// The orientation covering the larger angle around the vertex decides the bitangent sign,
+		// after splitMirroredVertices all faces around a vertex agree unless they are degenerate
+		float orientationWeight = 0.0f;
+		for(int c=offsets[i]; c<offsets[i+1]; ++c)
+		{
+			const FaceTangent& face = faceTangents[vertexCorners[c]/3];
+			orientationWeight += face.orientation * face.angles.data[vertexCorners[c]%3];
+		}
+		float sign = orientationWeight < 0.0f ? -1.0f : 1.0f;
+
+		float sum[3] = {0.0f, 0.0f, 0.0f};
+		for(int c=offsets[i]; c<offsets[i+1]; ++c)
+		{
+			const FaceTangent& face = faceTangents[vertexCorners[c]/3];
+			float projected[3];
+			if (face.orientation != sign || projectToPlane(normal, face.tangent.data, projected) <= 0.0f)
+			{
+				continue;
+			}
+			float weight = face.angles.data[vertexCorners[c]%3];
+			for(int k=0; k<3; ++k)
+			{
+				sum[k] += weight * projected[k];
+			}
+		}
+
+		// Without a usable texture mapping any direction in the tangent plane will do
+		float* tangent = tangents[i].data;
+		if (projectToPlane(normal, sum, tangent) <= 0.0f)
+		{
+			float axis[3] = {0.0f, 0.0f, 0.0f};
+			axis[fabs(normal[0]) < 0.9f ? 0 : 1] = 1.0f;
+			projectToPlane(normal, axis, tangent);
+		}
+		tangent[3] = sign;
+	}
+}
@@ -0,0 +1,20 @@
+#ifndef TANGENTS_H
+#define TANGENTS_H
+
+#include "objTypes.h"
+
+//! Generates a tangent frame for each vertex of a mesh with normals and texture coordinates
+//! The tangent of each face follows the texture u axis. As in MikkTSpace, the face tangents are
+//! projected into the plane of the vertex normal and averaged with corner angle weights. The fourth
+//! component is the bitangent sign, the bitangent is sign * cross(normal, tangent). The vertices should be
+//! split with splitMirroredVertices first, otherwise faces with mirrored texture coordinates only contribute
+//! to vertices where they are the majority.
+//! The tangents are empty if the mesh has no normals or texture coordinates.
+void generateTangents(const Mesh& mesh, std::vector<Vector4f>& tangents);
+
+//! Splits the vertices shared by faces with mirrored and unmirrored texture coordinates, as MikkTSpace does
+//! The mirrored faces get a copy of these vertices appended to the mesh, so every vertex has one bitangent sign.
+//! Returns the number of copied vertices, meshes without normals or texture coordinates are not changed.
+int splitMirroredVertices(Mesh& mesh);
+
+#endif
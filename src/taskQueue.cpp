@@ -0,0 +1,98 @@
+#include "taskQueue.h"
+
+#include <stdexcept>
+
+TaskQueue::TaskQueue()
+{
+	mBusy = false;
+	mStop = false;
+	mFailed = false;
+	mThread = boost::thread(&TaskQueue::run, this);
+}
+
+TaskQueue::~TaskQueue()
+{
+	{
+		boost::mutex::scoped_lock lock(mMutex);
+		mStop = true;
+	}
+	mCondition.notify_all();
+	mThread.join();
+}
+
+void TaskQueue::post(const TaskType& task)
+{
+	{
+		boost::mutex::scoped_lock lock(mMutex);
+		mTasks.push_back(task);
+	}
+	mCondition.notify_all();
+}
+
+void TaskQueue::wait()
+{
+	boost::mutex::scoped_lock lock(mMutex);
+	while(mBusy || !mTasks.empty())
+	{
+		mCondition.wait(lock);
+	}
+
+	if (mFailed)
+	{
+		mFailed = false;
+		throw std::runtime_error(mError);
+	}
+}
+
+void TaskQueue::run()
+{
+	boost::mutex::scoped_lock lock(mMutex);
+	while(true)
+	{
+		while(!mStop && mTasks.empty())
+		{
+			mCondition.wait(lock);
+		}
+		if (mTasks.empty())
+		{
+			return;
+		}
+
+		TaskType task = mTasks.front();
+		mTasks.pop_front();
+		mBusy = true;
+
+		// Tasks following a failed one are skipped, their input is likely missing
+		if (!mFailed)
+		{
+			lock.unlock();
+			std::string error;
+			try
+			{
+				task();
+			}
+			catch(std::exception& e)
+			{
+				error = e.what();
+				if (error.empty())
+				{
+					error = "unknown exception";
+				}
+			}
+			catch(...)
+			{
+				error = "unknown exception";
+			}
+			lock.lock();
+
+			if (!error.empty())
+			{
+				mFailed = true;
+				mError = error;
+			}
+		}
+
+		mBusy = false;
+		mCondition.notify_all();
+	}
+}
@@ -0,0 +1,36 @@
+#ifndef TASK_QUEUE_H
+#define TASK_QUEUE_H
+
+#include <deque>
+#include <string>
+
+#include <boost/function.hpp>
+#include <boost/thread.hpp>
+
+//! Runs tasks one after another on a single worker thread
+//! Tasks run in the order they were posted. Exceptions thrown by a task are rethrown by wait().
+class TaskQueue
+{
+public:
+	typedef boost::function<void ()> TaskType;
+private:
+	std::deque<TaskType>      mTasks;
+	boost::mutex              mMutex;
+	boost::condition_variable mCondition;
+	bool                      mBusy;
+	bool                      mStop;
+	bool                      mFailed;
+	std::string               mError;
+	boost::thread             mThread;
+public:
+	TaskQueue();
+	~TaskQueue();
+	//! Appends a task to the queue
+	void post(const TaskType& task);
+	//! Blocks until all posted tasks are finished
+	void wait();
+private:
+	void run();
+};
+
+#endif
@@ -0,0 +1,287 @@
+#include "textureArray.h"
+
+#include <map>
+#include <set>
+#include <algorithm>
+#include <functional>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <stdexcept>
+
+// Version of the texture array index format
+const int textureArrayIndexVersion = 2;
+
+// Array, layer and alpha mode of a baked component, textures without array use array and layer -1
+// Blended components are also keyed by the index of their transparency, the others use 0
+typedef std::pair<std::pair<int, int>, std::pair<int, int> > ArrayComponentKey;
+
+//=================================================================================================
+// Power of two nearest to the size, but not above the largest power of two within the limit
+//=================================================================================================
+static int layerSize(int size, int maxSize)
+{
+	int result = 1;
+	while (result*2 <= size)
+	{
+		result *= 2;
+	}
+	if (size - result > result*2 - size)
+	{
+		result *= 2;
+	}
+	while (maxSize > 0 && result > maxSize && result > 1)
+	{
+		result /= 2;
+	}
+	return result;
+}
+
+void buildTextureArrays(AtlasBuilder& atlas, const MaterialMapType& materials, const std::vector<std::string>& materialNames, const MaterialUsageListType& usage, int maxLayerSize, const std::string& baseFilename, TextureArrayLayout& layout)
+{
+	// Collect the textures of the used materials by layer size, in the order of their first use
+	// A texture is identified by its diffuse texture and the opacity map baked into its alpha
+	typedef std::pair<int, int> LayerSizeType;
+	typedef std::pair<std::string, std::string> LayerTextureType;
+	typedef std::map<LayerSizeType, std::vector<LayerTextureType> > SizeBucketMapType;
+	SizeBucketMapType buckets;
+	std::map<LayerTextureType, LayerSizeType> textureSizes;
+	std::vector<LayerTextureType> materialTextures(materialNames.size());
+	for(size_t id=1; id<materialNames.size() && id<usage.size(); ++id)
+	{
+		if (!usage[id].used)
+		{
+			continue;
+		}
+		MaterialMapType::const_iterator im = materials.find(materialNames[id]);
+		if (im == materials.end() || im->second.textureDiffuse.empty())
+		{
+			continue;
+		}
+		const std::string& filename = im->second.textureDiffuse;
+		const std::string& opacityFilename = im->second.textureTransparency;
+		LayerTextureType texture(filename, opacityFilename != filename ? opacityFilename : std::string());
+		materialTextures[id] = texture;
+		if (textureSizes.find(texture) == textureSizes.end())
+		{
+			int width, height;
+			atlas.getTextureSize(filename, width, height);
+			LayerSizeType size(layerSize(width, maxLayerSize), layerSize(height, maxLayerSize));
+			textureSizes[texture] = size;
+			buckets[size].push_back(texture);
+		}
+	}
+
+	// One array per bucket, from the smallest layers to the largest
+	std::map<LayerTextureType, std::pair<int, int> > textureLayers;
+	layout.arrays.clear();
+	for(SizeBucketMapType::const_iterator ib=buckets.begin(); ib!=buckets.end(); ++ib)
+	{
+		TextureArray array;
+		array.width = ib->first.first;
+		array.height = ib->first.second;
+		for(size_t l=0; l<ib->second.size(); ++l)
+		{
+			array.textures.push_back(ib->second[l].first);
+			array.opacityTextures.push_back(ib->second[l].second);
+			textureLayers[ib->second[l]] = std::make_pair(int(layout.arrays.size()), int(l));
+		}
+		std::ostringstream filename;
+		filename << baseFilename << ".array" << array.width << "x" << array.height << ".png";
+		array.filename = filename.str();
+		layout.arrays.push_back(array);
+	}
+
+	layout.materialArrays.assign(materialNames.size(), -1);
+	layout.materialLayers.assign(materialNames.size(), -1);
+	for(size_t id=1; id<materialTextures.size(); ++id)
+	{
+		if (!materialTextures[id].first.empty())
+		{
+			const std::pair<int, int>& layer = textureLayers[materialTextures[id]];
+			layout.materialArrays[id] = layer.first;
+			layout.materialLayers[id] = layer.second;
+		}
+	}
+}
+
+void classifyArrayTexels(AtlasBuilder& atlas, const TextureArrayLayout& layout, AlphaModeListType& modes, bool allTextured)
+{
+	// Materials sharing a texture share its classification
+	std::map<std::pair<int, int>, AlphaMode> layerModes;
+	for(size_t id=0; id<modes.size() && id<layout.materialArrays.size(); ++id)
+	{
+		int array = layout.materialArrays[id];
+		if (array < 0 || modes[id] == alphaBlended || (!allTextured && modes[id] != alphaTested))
+		{
+			continue;
+		}
+		std::pair<int, int> key(array, layout.materialLayers[id]);
+		std::map<std::pair<int, int>, AlphaMode>::iterator it = layerModes.find(key);
+		if (it == layerModes.end())
+		{
+			const TextureArray& textureArray = layout.arrays[key.first];
+			it = layerModes.insert(std::make_pair(key, atlas.classifyTexture(textureArray.textures[key.second], textureArray.opacityTextures[key.second]))).first;
+		}
+		modes[id] = it->second;
+	}
+}
+
+void saveTextureArrays(AtlasBuilder& atlas, const TextureArrayLayout& layout, const PngOptions& pngOptions)
+{
+	size_t layerCount = 0;
+	size_t texelCount = 0;
+	std::vector<unsigned char> pixels;
+	std::vector<unsigned char> layer;
+	for(size_t a=0; a<layout.arrays.size(); ++a)
+	{
+		const TextureArray& array = layout.arrays[a];
+		size_t layerBytes = 4*size_t(array.width)*size_t(array.height);
+		pixels.resize(layerBytes*array.textures.size());
+		for(size_t l=0; l<array.textures.size(); ++l)
+		{
+			atlas.renderTexture(array.textures[l], array.opacityTextures[l], array.width, array.height, layer);
+			std::copy(layer.begin(), layer.end(), pixels.begin() + l*layerBytes);
+		}
+		saveImage(array.filename, &pixels[0], array.width, int(array.height*array.textures.size()), pngOptions);
+		layerCount += array.textures.size();
+		texelCount += array.textures.size()*size_t(array.width)*size_t(array.height);
+	}
+	std::cerr << "wrote " << layerCount << " textures into " << layout.arrays.size() << " texture arrays with "
+		<< texelCount << " texels" << std::endl;
+}
+
+void bakeArrayMaterials(Mesh& mesh, const TextureArrayLayout& layout, const AlphaModeListType& modes, std::vector<TextureArrayMaterial>& arrayMaterials, const std::string& blendedPrefix)
+{
+	// Transparencies of the blended faces, from the most opaque one
+	std::set<float, std::greater<float> > transparencies;
+	std::vector<float> componentTransparencies(mesh.components.size(), 1.0f);
+	for(size_t c=0; c<mesh.components.size(); ++c)
+	{
+		int id = mesh.components[c].materialId;
+		if (id < (int) modes.size() && modes[id] == alphaBlended && !mesh.components[c].faces.empty())
+		{
+			MaterialMapType::const_iterator im = mesh.materials.find(mesh.materialNames[id]);
+			componentTransparencies[c] = im != mesh.materials.end() ? im->second.transparency : 1.0f;
+			transparencies.insert(componentTransparencies[c]);
+		}
+	}
+	std::vector<float> blendedTransparencies(transparencies.begin(), transparencies.end());
+
+	// Merge the components by layer, alpha mode and transparency, taking over the face list of the first component of each
+	typedef std::map<ArrayComponentKey, std::vector<Vector3i> > ArrayComponentMapType;
+	ArrayComponentMapType outputComponents;
+	for(size_t c=0; c<mesh.components.size(); ++c)
+	{
+		MeshComponent& input = mesh.components[c];
+		int id = input.materialId;
+		bool hasLayer = id < (int) layout.materialArrays.size() && layout.materialArrays[id] >= 0;
+		AlphaMode mode = id < (int) modes.size() ? modes[id] : alphaOpaque;
+		int transparency = 0;
+		if (mode == alphaBlended && !blendedTransparencies.empty())
+		{
+			transparency = int(std::lower_bound(blendedTransparencies.begin(), blendedTransparencies.end(), componentTransparencies[c], std::greater<float>()) - blendedTransparencies.begin());
+			transparency = std::min(transparency, int(blendedTransparencies.size())-1);
+		}
+		ArrayComponentKey key(std::make_pair(hasLayer ? layout.materialArrays[id] : -1, hasLayer ? layout.materialLayers[id] : -1), std::make_pair(int(mode), transparency));
+
+		std::vector<Vector3i>& faces = outputComponents[key];
+		if (faces.empty())
+		{
+			faces.swap(input.faces);
+		}
+		else
+		{
+			faces.insert(faces.end(), input.faces.begin(), input.faces.end());
+			std::vector<Vector3i>().swap(input.faces);
+		}
+	}
+	mesh.components.clear();
+	mesh.materials.clear();
+	mesh.materialNames.assign(1, std::string());
+
+	// Materials are named after their layer, so that meshes sharing the arrays share the materials
+	// Blended materials carry the transparency of their faces and take the prefix
+	const char* modeSuffixes[] = {"", "_alphaTested", "_blended"};
+	for(ArrayComponentMapType::iterator it=outputComponents.begin(); it!=outputComponents.end(); ++it)
+	{
+		int array = it->first.first.first;
+		int layer = it->first.first.second;
+		int mode = it->first.second.first;
+		int transparency = it->first.second.second;
+		std::ostringstream name;
+		if (mode == alphaBlended)
+		{
+			name << blendedPrefix;
+		}
+		if (array >= 0)
+		{
+			name << "array" << array << "_layer" << layer << modeSuffixes[mode];
+		}
+		else
+		{
+			name << "untextured" << modeSuffixes[mode];
+		}
+		if (mode == alphaBlended && blendedTransparencies.size() > 1)
+		{
+			name << transparency + 1;
+		}
+
+		mesh.components.push_back(MeshComponent());
+		MeshComponent& component = mesh.components.back();
+		component.componentName = name.str();
+		component.materialId = (int) mesh.materialNames.size();
+		component.faces.swap(it->second);
+
+		mesh.materialNames.push_back(name.str());
+		Material& mat = mesh.materials[name.str()];
+		if (array >= 0)
+		{
+			mat.textureDiffuse = layout.arrays[array].filename;
+			if (mode != alphaOpaque)
+			{
+				mat.textureTransparency = layout.arrays[array].filename;
+			}
+		}
+		if (mode == alphaBlended && !blendedTransparencies.empty())
+		{
+			mat.transparency = blendedTransparencies[transparency];
+		}
+
+		TextureArrayMaterial arrayMaterial;
+		arrayMaterial.name = name.str();
+		arrayMaterial.array = array;
+		arrayMaterial.layer = layer;
+		arrayMaterials.push_back(arrayMaterial);
+	}
+	std::cerr << "baked " << mesh.components.size() << " components sampling " << layout.arrays.size() << " texture arrays" << std::endl;
+}
+
+void writeTextureArrayIndex(const std::string& filename, const TextureArrayLayout& layout, const std::vector<TextureArrayMaterial>& arrayMaterials)
+{
+	std::ofstream outfile(filename.c_str());
+	if (!outfile)
+	{
+		throw std::runtime_error("Unable to open texture array index file: " + filename);
+	}
+
+	outfile << "textureArrays " << textureArrayIndexVersion << std::endl;
+	for(size_t a=0; a<layout.arrays.size(); ++a)
+	{
+		const TextureArray& array = layout.arrays[a];
+		outfile << "array " << a << " " << array.width << " " << array.height << " " << array.textures.size() << " " << array.filename << std::endl;
+		for(size_t l=0; l<array.textures.size(); ++l)
+		{
+			outfile << "layer " << a << " " << l << " " << array.textures[l] << std::endl;
+			if (!array.opacityTextures[l].empty())
+			{
+				outfile << "opacity " << a << " " << l << " " << array.opacityTextures[l] << std::endl;
+			}
+		}
+	}
+	for(size_t i=0; i<arrayMaterials.size(); ++i)
+	{
+		const TextureArrayMaterial& material = arrayMaterials[i];
+		outfile << "material " << material.array << " " << material.layer << " " << material.name << std::endl;
+	}
+}
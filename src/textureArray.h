@@ -0,0 +1,56 @@
+#ifndef TEXTURE_ARRAY_H
+#define TEXTURE_ARRAY_H
+
+#include "packer.h"
+
+#include <string>
+#include <vector>
+
+//! 2D texture array, one layer per source texture, stored as one image with the layers stacked from the top
+struct TextureArray
+{
+	int                      width;    //!< Size of each layer in pixels
+	int                      height;
+	std::string              filename;
+	std::vector<std::string> textures; //!< Source texture of each layer
+	std::vector<std::string> opacityTextures; //!< Opacity map baked into the alpha of each layer, empty if none
+};
+
+//! Texture arrays of a bake and the array layer sampled by each material id
+struct TextureArrayLayout
+{
+	std::vector<TextureArray> arrays;
+	std::vector<int>          materialArrays; //!< Array of each material id, -1 for materials without texture
+	std::vector<int>          materialLayers; //!< Layer of each material id within its array
+};
+
+//! Baked material and the array layer it samples, the layer of a material can not be expressed in mtl files
+struct TextureArrayMaterial
+{
+	std::string name;
+	int         array;
+	int         layer;
+};
+
+//! Buckets the textures of the used materials by size into texture arrays
+//! Materials with a separate opacity map (map_d) get their own layer, with the map in its alpha.
+//! Textures are scaled to the nearest power of two sizes no larger than maxLayerSize (0 for no limit), so that all
+//! layers have a full mip chain. Arrays are named baseFilename.arrayWxH.png. Must run on the thread that uses the atlas builder.
+void buildTextureArrays(AtlasBuilder& atlas, const MaterialMapType& materials, const std::vector<std::string>& materialNames, const MaterialUsageListType& usage, int maxLayerSize, const std::string& baseFilename, TextureArrayLayout& layout);
+
+//! Reclassifies textured materials by the alpha channel of their whole texture, like AtlasBuilder::classifyTexels
+void classifyArrayTexels(AtlasBuilder& atlas, const TextureArrayLayout& layout, AlphaModeListType& modes, bool allTextured);
+
+//! Renders and saves the layers of each texture array. Must run on the thread that uses the atlas builder.
+void saveTextureArrays(AtlasBuilder& atlas, const TextureArrayLayout& layout, const PngOptions& pngOptions);
+
+//! Merges the components of a mesh by array layer and alpha mode, each with a material sampling the array
+//! Texture coordinates are kept as they are, the baked materials are appended to arrayMaterials.
+//! Blended materials are prefixed with blendedPrefix, so meshes of a shared bake keep their own transparency, and
+//! there is one per layer and transparency, numbered from the most opaque one if the mesh has several transparencies.
+void bakeArrayMaterials(Mesh& mesh, const TextureArrayLayout& layout, const AlphaModeListType& modes, std::vector<TextureArrayMaterial>& arrayMaterials, const std::string& blendedPrefix = std::string());
+
+//! Writes the arrays with their layers and the layer of each baked material, one record per line with filenames last
+void writeTextureArrayIndex(const std::string& filename, const TextureArrayLayout& layout, const std::vector<TextureArrayMaterial>& arrayMaterials);
+
+#endif
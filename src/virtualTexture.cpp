@@ -0,0 +1,368 @@
+#include "virtualTexture.h"
+#include "packer.h"
+#include "resampler.h"
+
+#include <map>
+#include <set>
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <stdexcept>
+
+// Version of the page table format
+const int pageTableVersion = 1;
+
+// Row and column of a page
+typedef std::pair<int, int> PageKey;
+typedef std::vector<unsigned char> PixelBuffer;
+
+//=================================================================================================
+// Pages of one mip level
+// The contents of written pages are kept at half size until the next level no longer needs them.
+//=================================================================================================
+struct PageLevel
+{
+	int                            sizeX;
+	int                            sizeY;
+	int                            pagesX;
+	int                            pagesY;
+	int                            nextRow; //!< First row of pages that was not written yet
+	std::set<PageKey>              covered; //!< Pages whose contents overlap a packed texture
+	std::map<PageKey, PixelBuffer> halves;  //!< Contents of the written pages downsampled to half the page size
+};
+
+//=================================================================================================
+// Copies the part of a mip level covered by the downsampled pages of the level above into a window
+// Pixels outside the level or of pages that were not written are transparent black.
+//=================================================================================================
+void assembleWindow(const PageLevel& above, int pageSize, const AtlasRect& window, int sizeX, int sizeY, PixelBuffer& pixels)
+{
+	int half = pageSize/2;
+	pixels.assign(4*size_t(window.width)*size_t(window.height), 0);
+	int x1 = std::min(window.x + window.width, sizeX);
+	int y1 = std::min(window.y + window.height, sizeY);
+	if (x1 <= 0 || y1 <= 0)
+	{
+		return;
+	}
+
+	for(int py=std::max(0, window.y)/half; py<=(y1-1)/half; ++py)
+	{
+		for(int px=std::max(0, window.x)/half; px<=(x1-1)/half; ++px)
+		{
+			std::map<PageKey, PixelBuffer>::const_iterator it = above.halves.find(PageKey(py, px));
+			if (it == above.halves.end())
+			{
+				continue;
+			}
+			int sx0 = std::max(window.x, px*half);
+			int sx1 = std::min(x1, (px+1)*half);
+			int sy0 = std::max(window.y, py*half);
+			int sy1 = std::min(y1, (py+1)*half);
+			for(int y=sy0; y<sy1; ++y)
+			{
+				const unsigned char* source = &it->second[4*(size_t(y-py*half)*half + (sx0-px*half))];
+				std::copy(source, source + 4*(sx1-sx0), &pixels[4*(size_t(y-window.y)*window.width + (sx0-window.x))]);
+			}
+		}
+	}
+}
+
+//=================================================================================================
+// Writes the pages of all mip levels, one row of pages after another
+// A row of a lower level is written as soon as the rows of the level above that it covers are done.
+//=================================================================================================
+class PageWriter
+{
+private:
+	AtlasBuilder&                           mAtlas;
+	int                                     mPageSize;
+	int                                     mBorder;
+	std::string                             mBaseFilename;
+	std::vector<PageLevel>                  mLevels;
+	std::map<PageKey, std::vector<size_t> > mPageTiles; //!< Tiles overlapping each page of the first level, including its border
+	VirtualTexture&                         mTexture;
+public:
+	PageWriter(AtlasBuilder& atlas, const std::string& baseFilename, int pageSize, int border, VirtualTexture& texture);
+	void writePages();
+	void writeMipTail();
+private:
+	bool isRowReady(size_t level) const;
+	void writeRow(size_t level);
+};
+
+PageWriter::PageWriter(AtlasBuilder& atlas, const std::string& baseFilename, int pageSize, int border, VirtualTexture& texture)
+	: mAtlas(atlas), mPageSize(pageSize), mBorder(border), mBaseFilename(baseFilename), mTexture(texture)
+{
+	// Mip levels larger than one page are split into pages
+	for(int sizeX=texture.sizeX, sizeY=texture.sizeY; std::max(sizeX, sizeY) > pageSize; sizeX=std::max(1, sizeX/2), sizeY=std::max(1, sizeY/2))
+	{
+		PageLevel level;
+		level.sizeX = sizeX;
+		level.sizeY = sizeY;
+		level.pagesX = (sizeX + pageSize-1) / pageSize;
+		level.pagesY = (sizeY + pageSize-1) / pageSize;
+		level.nextRow = 0;
+		mLevels.push_back(level);
+	}
+	texture.levelCount = (int) mLevels.size();
+	if (mLevels.empty())
+	{
+		return;
+	}
+
+	// Find the pages covered by each tile on the first level, a page of a lower level is covered if one of its four pages above is
+	std::vector<AtlasRect> tileRects;
+	atlas.getTileRects(tileRects);
+	PageLevel& first = mLevels.front();
+	for(size_t t=0; t<tileRects.size(); ++t)
+	{
+		const AtlasRect& rect = tileRects[t];
+		for(int py=std::max(0, rect.y-border)/pageSize; py<=std::min(first.pagesY-1, (rect.y+rect.height+border-1)/pageSize); ++py)
+		{
+			for(int px=std::max(0, rect.x-border)/pageSize; px<=std::min(first.pagesX-1, (rect.x+rect.width+border-1)/pageSize); ++px)
+			{
+				mPageTiles[PageKey(py, px)].push_back(t);
+			}
+		}
+		for(int py=rect.y/pageSize; py<=(rect.y+rect.height-1)/pageSize; ++py)
+		{
+			for(int px=rect.x/pageSize; px<=(rect.x+rect.width-1)/pageSize; ++px)
+			{
+				first.covered.insert(PageKey(py, px));
+			}
+		}
+	}
+	for(size_t l=1; l<mLevels.size(); ++l)
+	{
+		for(std::set<PageKey>::const_iterator it=mLevels[l-1].covered.begin(); it!=mLevels[l-1].covered.end(); ++it)
+		{
+			mLevels[l].covered.insert(PageKey(it->first/2, it->second/2));
+		}
+	}
+}
+
+//=================================================================================================
+// Whether the rows of the level above needed by the next row of a level are written
+//=================================================================================================
+bool PageWriter::isRowReady(size_t level) const
+{
+	const PageLevel& current = mLevels[level];
+	const PageLevel& above = mLevels[level-1];
+	if (current.nextRow >= current.pagesY)
+	{
+		return false;
+	}
+	int lastY = std::min(current.sizeY, (current.nextRow+1)*mPageSize + mBorder) - 1;
+	return above.nextRow > lastY/(mPageSize/2) || above.nextRow >= above.pagesY;
+}
+
+//=================================================================================================
+// Writes the covered pages of the next row of a level
+//=================================================================================================
+void PageWriter::writeRow(size_t level)
+{
+	PageLevel& current = mLevels[level];
+	int row = current.nextRow;
+	int windowSize = mPageSize + 2*mBorder;
+	PixelBuffer pixels;
+	PixelBuffer contents(4*size_t(mPageSize)*size_t(mPageSize));
+	for(std::set<PageKey>::const_iterator it=current.covered.lower_bound(PageKey(row, 0)); it!=current.covered.end() && it->first==row; ++it)
+	{
+		AtlasRect window;
+		window.x = it->second*mPageSize - mBorder;
+		window.y = row*mPageSize - mBorder;
+		window.width = windowSize;
+		window.height = windowSize;
+		if (level == 0)
+		{
+			mAtlas.renderRect(window, mPageTiles[*it], pixels);
+		}
+		else
+		{
+			assembleWindow(mLevels[level-1], mPageSize, window, current.sizeX, current.sizeY, pixels);
+		}
+
+		VirtualTexturePage page;
+		page.level = (int) level;
+		page.x = it->second;
+		page.y = row;
+		std::ostringstream filename;
+		filename << mBaseFilename << ".page" << level << "_" << page.x << "_" << page.y << ".png";
+		page.filename = filename.str();
+		saveImage(page.filename, &pixels[0], windowSize, windowSize);
+		mTexture.pages.push_back(page);
+
+		// Keep the contents without the border at half size for the next level
+		for(int y=0; y<mPageSize; ++y)
+		{
+			const unsigned char* source = &pixels[4*(size_t(y+mBorder)*windowSize + mBorder)];
+			std::copy(source, source + 4*mPageSize, &contents[4*size_t(y)*mPageSize]);
+		}
+		PixelBuffer& half = current.halves[*it];
+		half.resize(contents.size()/4);
+		resampleImage(&contents[0], mPageSize, mPageSize, &half[0], mPageSize/2, mPageSize/2);
+	}
+	current.nextRow++;
+
+	// Drop the rows of the first level and of the level above that the following rows do not overlap
+	if (level == 0)
+	{
+		mPageTiles.erase(mPageTiles.begin(), mPageTiles.lower_bound(PageKey(current.nextRow, 0)));
+	}
+	else
+	{
+		std::map<PageKey, PixelBuffer>& above = mLevels[level-1].halves;
+		int firstY = std::max(0, current.nextRow*mPageSize - mBorder);
+		above.erase(above.begin(), above.lower_bound(PageKey(firstY/(mPageSize/2), 0)));
+	}
+}
+
+void PageWriter::writePages()
+{
+	while(!mLevels.empty() && mLevels.front().nextRow < mLevels.front().pagesY)
+	{
+		writeRow(0);
+		for(size_t level=1; level<mLevels.size(); ++level)
+		{
+			while(isRowReady(level))
+			{
+				writeRow(level);
+			}
+		}
+	}
+}
+
+//=================================================================================================
+// Writes the levels that fit into one page side by side, each one half the size of the previous one
+//=================================================================================================
+void PageWriter::writeMipTail()
+{
+	AtlasRect rect;
+	rect.x = 0;
+	rect.y = 0;
+	PixelBuffer level;
+	if (mLevels.empty())
+	{
+		rect.width = mTexture.sizeX;
+		rect.height = mTexture.sizeY;
+		std::vector<size_t> tiles;
+		std::vector<AtlasRect> tileRects;
+		mAtlas.getTileRects(tileRects);
+		for(size_t t=0; t<tileRects.size(); ++t)
+		{
+			tiles.push_back(t);
+		}
+		mAtlas.renderRect(rect, tiles, level);
+	}
+	else
+	{
+		rect.width = std::max(1, mLevels.back().sizeX/2);
+		rect.height = std::max(1, mLevels.back().sizeY/2);
+		assembleWindow(mLevels.back(), mPageSize, rect, rect.width, rect.height, level);
+	}
+
+	int tailWidth = 0;
+	for(int width=rect.width, height=rect.height; ; width=std::max(1, width/2), height=std::max(1, height/2))
+	{
+		tailWidth += width;
+		if (width == 1 && height == 1)
+		{
+			break;
+		}
+	}
+
+	PixelBuffer tail(4*size_t(tailWidth)*size_t(rect.height), 0);
+	PixelBuffer next;
+	MipTailLevel tailLevel;
+	tailLevel.level = mTexture.levelCount;
+	tailLevel.x = 0;
+	tailLevel.y = 0;
+	tailLevel.width = rect.width;
+	tailLevel.height = rect.height;
+	while(true)
+	{
+		for(int y=0; y<tailLevel.height; ++y)
+		{
+			const unsigned char* source = &level[4*size_t(y)*tailLevel.width];
+			std::copy(source, source + 4*tailLevel.width, &tail[4*(size_t(y)*tailWidth + tailLevel.x)]);
+		}
+		mTexture.tail.push_back(tailLevel);
+		if (tailLevel.width == 1 && tailLevel.height == 1)
+		{
+			break;
+		}
+
+		int width = std::max(1, tailLevel.width/2);
+		int height = std::max(1, tailLevel.height/2);
+		next.resize(4*size_t(width)*size_t(height));
+		resampleImage(&level[0], tailLevel.width, tailLevel.height, &next[0], width, height);
+		level.swap(next);
+		tailLevel.level++;
+		tailLevel.x += tailLevel.width;
+		tailLevel.width = width;
+		tailLevel.height = height;
+	}
+
+	mTexture.tailFilename = mBaseFilename + ".tail.png";
+	saveImage(mTexture.tailFilename, &tail[0], tailWidth, rect.height);
+}
+
+//=================================================================================================
+// Cuts the atlas into pages and writes the page table
+//=================================================================================================
+void saveVirtualTexture(AtlasBuilder& atlas, const std::string& pageTableFilename, const std::string& pageBaseFilename, int pageSize, int border)
+{
+	if (pageSize < 4*border || pageSize < 2 || (pageSize & (pageSize-1)) != 0)
+	{
+		throw std::runtime_error("the page size has to be a power of two and at least four times the page border");
+	}
+
+	AtlasPlacement placement;
+	atlas.getPlacement(placement);
+	VirtualTexture texture;
+	texture.sizeX = placement.sizeX;
+	texture.sizeY = placement.sizeY;
+	texture.pageSize = pageSize;
+	texture.border = border;
+
+	PageWriter writer(atlas, pageBaseFilename, pageSize, border, texture);
+	writer.writePages();
+	writer.writeMipTail();
+	writePageTable(pageTableFilename, texture);
+
+	size_t pageCount = 0;
+	for(int l=0, sizeX=texture.sizeX, sizeY=texture.sizeY; l<texture.levelCount; ++l, sizeX=std::max(1, sizeX/2), sizeY=std::max(1, sizeY/2))
+	{
+		pageCount += size_t((sizeX + pageSize-1) / pageSize) * size_t((sizeY + pageSize-1) / pageSize);
+	}
+	std::cerr << "wrote " << texture.pages.size() << " of " << pageCount << " pages in " << texture.levelCount << " levels and " << texture.tail.size() << " levels in the mip tail" << std::endl;
+}
+
+//=================================================================================================
+// Writes a page table
+//=================================================================================================
+void writePageTable(const std::string& filename, const VirtualTexture& texture)
+{
+	std::ofstream outfile(filename.c_str());
+	if (!outfile)
+	{
+		throw std::runtime_error("Unable to open page table file: " + filename);
+	}
+
+	outfile << "virtualTexture " << pageTableVersion << std::endl;
+	outfile << "atlas " << texture.sizeX << " " << texture.sizeY << std::endl;
+	outfile << "pages " << texture.pageSize << " " << texture.border << " " << texture.levelCount << std::endl;
+	outfile << "tail " << texture.tailFilename << std::endl;
+	for(size_t i=0; i<texture.tail.size(); ++i)
+	{
+		const MipTailLevel& level = texture.tail[i];
+		outfile << "tailLevel " << level.level << " " << level.x << " " << level.y << " " << level.width << " " << level.height << std::endl;
+	}
+	for(size_t i=0; i<texture.pages.size(); ++i)
+	{
+		const VirtualTexturePage& page = texture.pages[i];
+		outfile << "page " << page.level << " " << page.x << " " << page.y << " " << page.filename << std::endl;
+	}
+}
@@ -0,0 +1,53 @@
+#ifndef VIRTUAL_TEXTURE_H
+#define VIRTUAL_TEXTURE_H
+
+#include <string>
+#include <vector>
+
+class AtlasBuilder;
+
+//! Pixels of the neighbouring pages copied around the contents of each page, so that pages can be filtered on their own
+const int virtualPageBorder = 4;
+
+//! Page of a virtual texture, x and y count pages from the top left corner of its mip level
+struct VirtualTexturePage
+{
+	int         level;
+	int         x;
+	int         y;
+	std::string filename;
+};
+
+//! Placement of a mip level in the mip tail image, in pixels
+struct MipTailLevel
+{
+	int level;
+	int x;
+	int y;
+	int width;
+	int height;
+};
+
+//! Page table of a virtual texture, only pages covered by packed textures are listed
+struct VirtualTexture
+{
+	int                             sizeX;        //!< Size of the atlas in pixels
+	int                             sizeY;
+	int                             pageSize;     //!< Width and height of the contents of a page, without the border
+	int                             border;
+	int                             levelCount;   //!< Number of mip levels split into pages
+	std::vector<VirtualTexturePage> pages;
+	std::string                     tailFilename; //!< Image with the mip levels that fit into one page, side by side
+	std::vector<MipTailLevel>       tail;
+};
+
+//! Cuts the packed atlas into pages of pageSize plus a border on each side and writes them with a page table
+//! Mip levels larger than one page are cut into pages as well, the smaller levels go into the mip tail image.
+//! The atlas is rendered page by page and never stitched as a whole, lower levels are built from downsampled
+//! rows of the level above. Pages are named pageBaseFilename.pageL_X_Y.png. Must run on the thread that uses the atlas builder.
+void saveVirtualTexture(AtlasBuilder& atlas, const std::string& pageTableFilename, const std::string& pageBaseFilename, int pageSize, int border);
+
+//! Writes a page table, one record per line with filenames last
+void writePageTable(const std::string& filename, const VirtualTexture& texture);
+
+#endif
@@ -0,0 +1,209 @@
+#include "welder.h"
+#include <algorithm>
+#include <limits>
+#include <cmath>
+
+// Largest distance between welded positions, relative to the diagonal of the bounding box
+const float weldPositionTolerance = 1e-6f;
+// Smallest cosine between welded normals
+const float weldNormalCosine = 0.9999f;
+// Largest difference between welded texture coordinates
+const float weldTexcoordTolerance = 1e-6f;
+// Grid coordinates are packed into 21 bits per axis
+const int weldGridBits = 21;
+
+//=================================================================================================
+// Grid cell of a vertex, packed into one key
+//=================================================================================================
+inline unsigned long long packCell(long long x, long long y, long long z)
+{
+	const long long mask = (1LL << weldGridBits) - 1;
+	return (unsigned long long) (x & mask) | ((unsigned long long) (y & mask) << weldGridBits) | ((unsigned long long) (z & mask) << (2*weldGridBits));
+}
+
+//=================================================================================================
+// Compares the attributes of two vertices
+//=================================================================================================
+bool canWeld(const Mesh& mesh, int a, int b, float positionTolerance, bool hasNormals, bool hasTexCoord)
+{
+	const float* pa = mesh.vertices[a].data;
+	const float* pb = mesh.vertices[b].data;
+	for(int k=0; k<3; ++k)
+	{
+		if (fabs(pa[k]-pb[k]) > positionTolerance)
+		{
+			return false;
+		}
+	}
+	if (hasNormals)
+	{
+		const float* na = mesh.normals[a].data;
+		const float* nb = mesh.normals[b].data;
+		if (na[0]*nb[0] + na[1]*nb[1] + na[2]*nb[2] < weldNormalCosine)
+		{
+			return false;
+		}
+	}
+	if (hasTexCoord)
+	{
+		const float* ta = mesh.texcoord[a].data;
+		const float* tb = mesh.texcoord[b].data;
+		if (fabs(ta[0]-tb[0]) > weldTexcoordTolerance || fabs(ta[1]-tb[1]) > weldTexcoordTolerance)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+//=================================================================================================
+// Welds vertices with matching attributes
+// Each vertex is merged into the first earlier vertex it matches in its own or a neighbouring cell.
+// The candidates are searched in parallel, the merges are resolved in vertex order.
+//=================================================================================================
+WeldStatistics weldVertices(Mesh& mesh)
+{
+	WeldStatistics statistics;
+	int vertexCount = (int) mesh.vertices.size();
+	statistics.vertexCount = size_t(vertexCount);
+	if (vertexCount == 0)
+	{
+		return statistics;
+	}
+	bool hasNormals = mesh.normals.size() == mesh.vertices.size();
+	bool hasTexCoord = mesh.texcoord.size() == mesh.vertices.size();
+
+	// The cells are at least as large as the tolerance, so matching vertices are in neighbouring cells
+	float minimum[3];
+	float maximum[3];
+	for(int k=0; k<3; ++k)
+	{
+		minimum[k] = std::numeric_limits<float>::max();
+		maximum[k] = -std::numeric_limits<float>::max();
+	}
+	for(int i=0; i<vertexCount; ++i)
+	{
+		for(int k=0; k<3; ++k)
+		{
+			minimum[k] = std::min(minimum[k], mesh.vertices[i].data[k]);
+			maximum[k] = std::max(maximum[k], mesh.vertices[i].data[k]);
+		}
+	}
+	float diagonal = 0.0f;
+	float extent = 0.0f;
+	for(int k=0; k<3; ++k)
+	{
+		diagonal += (maximum[k]-minimum[k])*(maximum[k]-minimum[k]);
+		extent = std::max(extent, maximum[k]-minimum[k]);
+	}
+	float positionTolerance = weldPositionTolerance * sqrt(diagonal);
+	float cellSize = std::max(positionTolerance, extent / float((1 << (weldGridBits-1)) - 1));
+	if (cellSize <= 0.0f)
+	{
+		cellSize = 1.0f;
+	}
+
+	// Sort the vertices by cell, the vertices of a cell are found by binary search
+	std::vector<long long> cells(3*size_t(vertexCount));
+	std::vector<std::pair<unsigned long long, int> > sortedCells(vertexCount);
+	#pragma omp parallel for
+	for(int i=0; i<vertexCount; ++i)
+	{
+		long long* cell = &cells[3*size_t(i)];
+		for(int k=0; k<3; ++k)
+		{
+			cell[k] = (long long) floor((mesh.vertices[i].data[k] - minimum[k]) / cellSize);
+		}
+		sortedCells[i] = std::make_pair(packCell(cell[0], cell[1], cell[2]), i);
+	}
+	std::sort(sortedCells.begin(), sortedCells.end());
+
+	// Find the first earlier matching vertex of each vertex
+	std::vector<int> target(vertexCount);
+	#pragma omp parallel for schedule(dynamic, 1024)
+	for(int i=0; i<vertexCount; ++i)
+	{
+		const long long* cell = &cells[3*size_t(i)];
+		int best = i;
+		for(int dz=-1; dz<=1; ++dz)
+		{
+			for(int dy=-1; dy<=1; ++dy)
+			{
+				for(int dx=-1; dx<=1; ++dx)
+				{
+					std::pair<unsigned long long, int> first(packCell(cell[0]+dx, cell[1]+dy, cell[2]+dz), 0);
+					std::vector<std::pair<unsigned long long, int> >::const_iterator it = std::lower_bound(sortedCells.begin(), sortedCells.end(), first);
+					for(; it!=sortedCells.end() && it->first==first.first && it->second<best; ++it)
+					{
+						if (canWeld(mesh, i, it->second, positionTolerance, hasNormals, hasTexCoord))
+						{
+							best = it->second;
+							break;
+						}
+					}
+				}
+			}
+		}
+		target[i] = best;
+	}
+
+	// Resolve chains of merges and compact the vertices
+	std::vector<int> remap(vertexCount);
+	int keptCount = 0;
+	for(int i=0; i<vertexCount; ++i)
+	{
+		if (target[i] == i)
+		{
+			remap[i] = keptCount;
+			mesh.vertices[keptCount] = mesh.vertices[i];
+			if (hasNormals)
+			{
+				mesh.normals[keptCount] = mesh.normals[i];
+			}
+			if (hasTexCoord)
+			{
+				mesh.texcoord[keptCount] = mesh.texcoord[i];
+			}
+			keptCount++;
+		}
+		else
+		{
+			remap[i] = remap[target[i]];
+		}
+	}
+	if (keptCount == vertexCount)
+	{
+		return statistics;
+	}
+	statistics.weldedCount = size_t(vertexCount - keptCount);
+	mesh.vertices.resize(keptCount);
+	if (hasNormals)
+	{
+		mesh.normals.resize(keptCount);
+	}
+	if (hasTexCoord)
+	{
+		mesh.texcoord.resize(keptCount);
+	}
+
+	// Remap the faces, dropping the ones that collapsed
+	for(ComponentListType::iterator ic=mesh.components.begin(); ic!=mesh.components.end(); ++ic)
+	{
+		size_t faceCount = 0;
+		for(size_t f=0; f<ic->faces.size(); ++f)
+		{
+			Vector3i face = ic->faces[f];
+			for(int k=0; k<3; ++k)
+			{
+				face.data[k] = remap[face.data[k]];
+			}
+			if (face.data[0] != face.data[1] && face.data[1] != face.data[2] && face.data[2] != face.data[0])
+			{
+				ic->faces[faceCount++] = face;
+			}
+		}
+		statistics.removedFaces += ic->faces.size() - faceCount;
+		ic->faces.resize(faceCount);
+	}
+	return statistics;
+}
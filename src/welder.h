@@ -0,0 +1,25 @@
+#ifndef WELDER_H
+#define WELDER_H
+
+#include "objTypes.h"
+
+//! Vertices of a welded mesh and what welding removed
+struct WeldStatistics
+{
+	size_t vertexCount;  //!< Vertices before welding
+	size_t weldedCount;  //!< Vertices merged into an earlier vertex
+	size_t removedFaces; //!< Faces that collapsed
+	WeldStatistics()
+	{
+		vertexCount = 0;
+		weldedCount = 0;
+		removedFaces = 0;
+	}
+};
+
+//! Merges vertices whose position, normal and texture coordinate values match within small tolerances
+//! Vertices are looked up in a spatial hash grid, so duplicates written as separate obj records are
+//! found without comparing all pairs. Faces that collapse are removed.
+WeldStatistics weldVertices(Mesh& mesh);
+
+#endif